@@ -0,0 +1,208 @@
+#include "AssetArchive.h"
+#include "SimpleModel.h"
+#include "CompressedImage.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+	const char ARCHIVE_MAGIC[4] = { 'S', 'P', 'A', 'K' };
+	const uint32_t ARCHIVE_VERSION = 1;
+	const uint64_t ARCHIVE_ALIGNMENT = 16;
+
+	uint64_t alignOffset(uint64_t offset)
+	{
+		return (offset + ARCHIVE_ALIGNMENT - 1) & ~(ARCHIVE_ALIGNMENT - 1);
+	}
+
+	bool readFile(const std::string& filename, std::vector<char>& data)
+	{
+		std::ifstream in(filename, std::ios::binary | std::ios::ate);
+		if (!in)
+			return false;
+
+		data.resize(static_cast<size_t>(in.tellg()));
+		in.seekg(0);
+		return static_cast<bool>(in.read(data.data(), data.size()));
+	}
+
+	// cook one manifest line and read back the bytes to pack
+	bool cookAsset(const std::string& kind, const std::string& path, AssetEntry& entry, std::vector<char>& data)
+	{
+		if (kind == "mesh" || kind == "mesh_uv")
+		{
+			bool texture = kind == "mesh_uv";
+			entry.type = ASSET_MESH;
+			entry.param = texture ? 1 : 0;
+			return SimpleModel::cook(path.c_str(), texture) && readFile(path + ".mesh", data);
+		}
+
+		if (kind == "bc1" || kind == "bc3" || kind == "bc5")
+		{
+			TextureCompression compression = kind == "bc1" ? COMPRESSION_BC1 : kind == "bc3" ? COMPRESSION_BC3 : COMPRESSION_BC5;
+			entry.type = ASSET_TEXTURE;
+			entry.param = compression;
+			CompressedImage image;
+			return image.load(path, compression) && readFile(CompressedImage::getCacheFile(path, compression), data);
+		}
+
+		if (kind == "shader" || kind == "raw")
+		{
+			entry.type = kind == "shader" ? ASSET_SHADER : ASSET_RAW;
+			entry.param = 0;
+			return readFile(path, data);
+		}
+
+		std::cout << "Unknown asset kind: " << kind << std::endl;
+		return false;
+	}
+}
+
+std::string AssetArchive::normalize(const std::string& name)
+{
+	std::string result = name;
+	for (char& c : result)
+	{
+		if (c == '\\')
+			c = '/';
+	}
+	while (result.compare(0, 2, "./") == 0)
+		result.erase(0, 2);
+	return result;
+}
+
+bool AssetArchive::open(const std::string& filename)
+{
+	mEntries.clear();
+	if (!mFile.open(filename) || mFile.size() < sizeof(AssetArchiveHeader))
+	{
+		mFile.close();
+		return false;
+	}
+
+	AssetArchiveHeader header;
+	std::memcpy(&header, mFile.data(), sizeof(header));
+
+	uint64_t tocEnd = header.tocOffset + static_cast<uint64_t>(header.numEntries) * sizeof(AssetEntry);
+	if (std::memcmp(header.magic, ARCHIVE_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != ARCHIVE_VERSION ||
+		header.tocOffset % alignof(AssetEntry) != 0 ||
+		tocEnd > mFile.size() || header.namesOffset > mFile.size())
+	{
+		std::cout << "Invalid asset archive: " << filename << std::endl;
+		mFile.close();
+		return false;
+	}
+
+	// entries are used in place, only the name lookup is built
+	const AssetEntry* entries = reinterpret_cast<const AssetEntry*>(mFile.data() + header.tocOffset);
+	const char* names = reinterpret_cast<const char*>(mFile.data() + header.namesOffset);
+	uint64_t namesSize = mFile.size() - header.namesOffset;
+	for (uint32_t i = 0; i < header.numEntries; i++)
+	{
+		const AssetEntry& entry = entries[i];
+		if (static_cast<uint64_t>(entry.nameOffset) + entry.nameLength > namesSize ||
+			entry.dataOffset + entry.size > mFile.size())
+		{
+			std::cout << "Invalid asset archive: " << filename << std::endl;
+			mEntries.clear();
+			mFile.close();
+			return false;
+		}
+		mEntries[std::string(names + entry.nameOffset, entry.nameLength)] = &entry;
+	}
+
+	return true;
+}
+
+const AssetEntry* AssetArchive::find(const std::string& name) const
+{
+	auto it = mEntries.find(normalize(name));
+	return it != mEntries.end() ? it->second : nullptr;
+}
+
+bool AssetArchive::pack(const std::string& archive, const std::string& manifest)
+{
+	std::ifstream in(manifest);
+	if (!in)
+	{
+		std::cout << "Unable to open manifest: " << manifest << std::endl;
+		return false;
+	}
+
+	std::vector<AssetEntry> entries;
+	std::vector<std::vector<char>> blobs;
+	std::string names;
+
+	std::string line;
+	while (std::getline(in, line))
+	{
+		std::istringstream fields(line);
+		std::string kind, path;
+		if (!(fields >> kind >> path) || kind[0] == '#')
+			continue;
+
+		AssetEntry entry = {};
+		std::vector<char> data;
+		if (!cookAsset(kind, path, entry, data))
+		{
+			std::cout << "Unable to pack: " << path << std::endl;
+			return false;
+		}
+
+		std::string name = normalize(path);
+		entry.nameOffset = static_cast<uint32_t>(names.size());
+		entry.nameLength = static_cast<uint32_t>(name.size());
+		entry.size = data.size();
+		names += name;
+
+		entries.push_back(entry);
+		blobs.push_back(std::move(data));
+		std::cout << "Packed " << name << " (" << entry.size << " bytes)" << std::endl;
+	}
+
+	// header | entry table | names | 16-byte aligned data
+	AssetArchiveHeader header = {};
+	std::memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+	header.version = ARCHIVE_VERSION;
+	header.numEntries = static_cast<uint32_t>(entries.size());
+	header.tocOffset = sizeof(header);
+	header.namesOffset = header.tocOffset + entries.size() * sizeof(AssetEntry);
+
+	uint64_t offset = header.namesOffset + names.size();
+	for (AssetEntry& entry : entries)
+	{
+		entry.dataOffset = alignOffset(offset);
+		offset = entry.dataOffset + entry.size;
+	}
+
+	std::ofstream out(archive, std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		std::cout << "Unable to write archive: " << archive << std::endl;
+		return false;
+	}
+
+	const char padding[ARCHIVE_ALIGNMENT] = {};
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(AssetEntry));
+	out.write(names.data(), names.size());
+	offset = header.namesOffset + names.size();
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		out.write(padding, entries[i].dataOffset - offset);
+		out.write(blobs[i].data(), blobs[i].size());
+		offset = entries[i].dataOffset + entries[i].size;
+	}
+
+	if (!out)
+	{
+		std::cout << "Unable to write archive: " << archive << std::endl;
+		return false;
+	}
+	std::cout << "Wrote " << entries.size() << " assets to " << archive << std::endl;
+	return true;
+}
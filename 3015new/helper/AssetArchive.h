@@ -0,0 +1,68 @@
+#ifndef ASSET_ARCHIVE_H
+#define ASSET_ARCHIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "MappedFile.h"
+
+// what an archive entry holds
+enum AssetType
+{
+	ASSET_RAW = 0,		// source file bytes as they are
+	ASSET_MESH,			// cooked <model>.mesh, param is the texture coordinate flag
+	ASSET_TEXTURE,		// cooked <image>.bcN mip chain, param is the TextureCompression
+	ASSET_SHADER,		// GLSL source
+};
+
+// header at the start of an archive, followed by the table of contents at tocOffset
+struct AssetArchiveHeader
+{
+	char magic[4];			// "SPAK"
+	uint32_t version;
+	uint32_t numEntries;
+	uint32_t reserved;
+	uint64_t tocOffset;		// byte offset of the AssetEntry table
+	uint64_t namesOffset;	// byte offset of the name string table
+};
+
+struct AssetEntry
+{
+	uint32_t type;			// AssetType
+	uint32_t param;
+	uint32_t nameOffset;	// into the name string table
+	uint32_t nameLength;
+	uint64_t dataOffset;	// byte offset of the data, 16-byte aligned
+	uint64_t size;
+};
+
+/*****************************************************************
+ * read-only archive of cooked assets, mapped in one piece so that
+ * loading an asset is a lookup instead of a file open and a parse
+ *****************************************************************/
+class AssetArchive
+{
+public:
+	// map an archive, returns false if it is missing or not a valid archive
+	bool open(const std::string& filename);
+	bool isOpen() const { return mFile.isOpen(); }
+
+	// entry for a path as it is named in the manifest, null if the archive does not hold it
+	const AssetEntry* find(const std::string& name) const;
+	const unsigned char* getData(const AssetEntry& entry) const { return mFile.data() + entry.dataOffset; }
+
+	// cook every asset listed in a manifest and write them to an archive, no OpenGL needed
+	// each manifest line is "<kind> <path>", kind is one of mesh, mesh_uv, bc1, bc3, bc5, shader or raw
+	static bool pack(const std::string& archive, const std::string& manifest);
+
+	// manifest paths and lookups share one spelling, e.g. "./media/x.obj" and "media\x.obj" match
+	static std::string normalize(const std::string& name);
+
+private:
+	MappedFile mFile;
+	std::unordered_map<std::string, const AssetEntry*> mEntries;
+};
+
+#endif
@@ -0,0 +1,284 @@
+#include "BlockEncoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef BLOCK_ENCODER_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+	// gather a 4x4 block of RGBA pixels, clamping at the image edges
+	void loadBlock(const uint8_t* rgba, int width, int height, int blockX, int blockY, uint8_t block[64])
+	{
+		for (int y = 0; y < 4; y++)
+		{
+			int sourceY = std::min(blockY * 4 + y, height - 1);
+			for (int x = 0; x < 4; x++)
+			{
+				int sourceX = std::min(blockX * 4 + x, width - 1);
+				std::memcpy(block + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+			}
+		}
+	}
+
+	// per-channel minimum and maximum of the 16 pixels
+	void blockBounds(const uint8_t block[64], uint8_t minColor[4], uint8_t maxColor[4])
+	{
+#ifdef BLOCK_ENCODER_USE_SSE
+		__m128i row0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+		__m128i row1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16));
+		__m128i row2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 32));
+		__m128i row3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 48));
+
+		__m128i lo = _mm_min_epu8(_mm_min_epu8(row0, row1), _mm_min_epu8(row2, row3));
+		__m128i hi = _mm_max_epu8(_mm_max_epu8(row0, row1), _mm_max_epu8(row2, row3));
+
+		// fold the four pixels of each register down to one
+		lo = _mm_min_epu8(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(1, 0, 3, 2)));
+		lo = _mm_min_epu8(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+		hi = _mm_max_epu8(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(1, 0, 3, 2)));
+		hi = _mm_max_epu8(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+
+		int packedMin = _mm_cvtsi128_si32(lo);
+		int packedMax = _mm_cvtsi128_si32(hi);
+		std::memcpy(minColor, &packedMin, 4);
+		std::memcpy(maxColor, &packedMax, 4);
+#else
+		for (int c = 0; c < 4; c++)
+		{
+			minColor[c] = 255;
+			maxColor[c] = 0;
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				minColor[c] = std::min(minColor[c], block[i * 4 + c]);
+				maxColor[c] = std::max(maxColor[c], block[i * 4 + c]);
+			}
+		}
+#endif
+	}
+
+	uint16_t packRGB565(const uint8_t color[4])
+	{
+		return static_cast<uint16_t>(((color[0] * 31 + 127) / 255) << 11 |
+			((color[1] * 63 + 127) / 255) << 5 |
+			((color[2] * 31 + 127) / 255));
+	}
+
+	void unpackRGB565(uint16_t packed, int color[3])
+	{
+		int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// index of the closest palette entry for each of the 16 pixels
+	void selectColorIndices(const uint8_t block[64], const int palette[4][3], uint8_t indices[16])
+	{
+#ifdef BLOCK_ENCODER_USE_SSE
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i rgbMask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+
+		for (int group = 0; group < 4; group++)
+		{
+			// four pixels widened to 16 bits, alpha lanes cleared
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + group * 16));
+			__m128i lo = _mm_and_si128(_mm_unpacklo_epi8(pixels, zero), rgbMask);
+			__m128i hi = _mm_and_si128(_mm_unpackhi_epi8(pixels, zero), rgbMask);
+
+			__m128i bestDistance = _mm_set1_epi32(0x7FFFFFFF);
+			__m128i bestIndex = zero;
+
+			for (int p = 0; p < 4; p++)
+			{
+				__m128i color = _mm_set_epi16(0, static_cast<short>(palette[p][2]), static_cast<short>(palette[p][1]), static_cast<short>(palette[p][0]),
+					0, static_cast<short>(palette[p][2]), static_cast<short>(palette[p][1]), static_cast<short>(palette[p][0]));
+
+				// squared differences summed in pairs, then pairs summed per pixel
+				__m128i dlo = _mm_sub_epi16(lo, color);
+				__m128i dhi = _mm_sub_epi16(hi, color);
+				__m128 slo = _mm_castsi128_ps(_mm_madd_epi16(dlo, dlo));
+				__m128 shi = _mm_castsi128_ps(_mm_madd_epi16(dhi, dhi));
+				__m128i distance = _mm_add_epi32(
+					_mm_castps_si128(_mm_shuffle_ps(slo, shi, _MM_SHUFFLE(2, 0, 2, 0))),
+					_mm_castps_si128(_mm_shuffle_ps(slo, shi, _MM_SHUFFLE(3, 1, 3, 1))));
+
+				// keep the nearer entry, SSE2 has no 32-bit min so blend with a mask
+				__m128i closer = _mm_cmplt_epi32(distance, bestDistance);
+				bestDistance = _mm_or_si128(_mm_and_si128(closer, distance), _mm_andnot_si128(closer, bestDistance));
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+			}
+
+			alignas(16) int32_t best[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(best), bestIndex);
+			for (int i = 0; i < 4; i++)
+				indices[group * 4 + i] = static_cast<uint8_t>(best[i]);
+		}
+#else
+		for (int i = 0; i < 16; i++)
+		{
+			int bestDistance = 0x7FFFFFFF;
+			for (int p = 0; p < 4; p++)
+			{
+				int dr = block[i * 4] - palette[p][0];
+				int dg = block[i * 4 + 1] - palette[p][1];
+				int db = block[i * 4 + 2] - palette[p][2];
+				int distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					indices[i] = static_cast<uint8_t>(p);
+				}
+			}
+		}
+#endif
+	}
+
+	// BC1 colour block: two RGB565 endpoints and 2-bit indices
+	void encodeColorBlock(const uint8_t block[64], uint8_t output[8])
+	{
+		uint8_t minColor[4], maxColor[4];
+		blockBounds(block, minColor, maxColor);
+
+		// pull the endpoints in by 1/16 of the range, the extremes are rarely the best fit
+		for (int c = 0; c < 3; c++)
+		{
+			int inset = (maxColor[c] - minColor[c]) >> 4;
+			minColor[c] = static_cast<uint8_t>(std::min(255, minColor[c] + inset));
+			maxColor[c] = static_cast<uint8_t>(std::max(0, maxColor[c] - inset));
+		}
+
+		// the box diagonal from min to max assumes every channel rises with red,
+		// swap the ends of channels that fall as red rises
+		int mean[3] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 3; c++)
+				mean[c] += block[i * 4 + c];
+		}
+		int covariance[3] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			int red = block[i * 4] * 16 - mean[0];
+			for (int c = 1; c < 3; c++)
+				covariance[c] += red * (block[i * 4 + c] * 16 - mean[c]);
+		}
+		for (int c = 1; c < 3; c++)
+		{
+			if (covariance[c] < 0)
+				std::swap(minColor[c], maxColor[c]);
+		}
+
+		uint16_t color0 = packRGB565(maxColor);
+		uint16_t color1 = packRGB565(minColor);
+		uint32_t bits = 0;
+
+		// color0 > color1 selects the four colour mode, equal endpoints need no indices
+		if (color0 != color1)
+		{
+			// the order only picks the mode, swapping endpoints just swaps the palette
+			if (color0 < color1)
+				std::swap(color0, color1);
+
+			int palette[4][3];
+			unpackRGB565(color0, palette[0]);
+			unpackRGB565(color1, palette[1]);
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			uint8_t indices[16];
+			selectColorIndices(block, palette, indices);
+			for (int i = 0; i < 16; i++)
+				bits |= static_cast<uint32_t>(indices[i]) << (i * 2);
+		}
+
+		output[0] = static_cast<uint8_t>(color0);
+		output[1] = static_cast<uint8_t>(color0 >> 8);
+		output[2] = static_cast<uint8_t>(color1);
+		output[3] = static_cast<uint8_t>(color1 >> 8);
+		std::memcpy(output + 4, &bits, 4);
+	}
+
+	// BC4 single channel block: two 8-bit endpoints and 3-bit indices
+	void encodeChannelBlock(const uint8_t block[64], int channel, uint8_t output[8])
+	{
+		uint8_t minColor[4], maxColor[4];
+		blockBounds(block, minColor, maxColor);
+		int lo = minColor[channel];
+		int hi = maxColor[channel];
+
+		uint64_t bits = 0;
+		if (hi != lo)
+		{
+			// eight value mode: index 0 = hi, 1 = lo, 2..7 step from hi towards lo
+			int range = hi - lo;
+			for (int i = 0; i < 16; i++)
+			{
+				int step = ((block[i * 4 + channel] - lo) * 7 + range / 2) / range;
+				uint64_t index = step == 7 ? 0 : (step == 0 ? 1 : 8 - step);
+				bits |= index << (i * 3);
+			}
+		}
+
+		output[0] = static_cast<uint8_t>(hi);
+		output[1] = static_cast<uint8_t>(lo);
+		for (int i = 0; i < 6; i++)
+			output[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+	}
+}
+
+namespace BlockEncoder
+{
+	size_t encodedSize(int width, int height, int blockBytes)
+	{
+		return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+	}
+
+	void encodeBC1(const uint8_t* rgba, int width, int height, uint8_t* output)
+	{
+		uint8_t block[64];
+		for (int y = 0; y < (height + 3) / 4; y++)
+		{
+			for (int x = 0; x < (width + 3) / 4; x++, output += 8)
+			{
+				loadBlock(rgba, width, height, x, y, block);
+				encodeColorBlock(block, output);
+			}
+		}
+	}
+
+	void encodeBC3(const uint8_t* rgba, int width, int height, uint8_t* output)
+	{
+		uint8_t block[64];
+		for (int y = 0; y < (height + 3) / 4; y++)
+		{
+			for (int x = 0; x < (width + 3) / 4; x++, output += 16)
+			{
+				loadBlock(rgba, width, height, x, y, block);
+				encodeChannelBlock(block, 3, output);
+				encodeColorBlock(block, output + 8);
+			}
+		}
+	}
+
+	void encodeBC5(const uint8_t* rgba, int width, int height, uint8_t* output)
+	{
+		uint8_t block[64];
+		for (int y = 0; y < (height + 3) / 4; y++)
+		{
+			for (int x = 0; x < (width + 3) / 4; x++, output += 16)
+			{
+				loadBlock(rgba, width, height, x, y, block);
+				encodeChannelBlock(block, 0, output);
+				encodeChannelBlock(block, 1, output + 8);
+			}
+		}
+	}
+}
@@ -0,0 +1,30 @@
+#ifndef BLOCK_ENCODER_H
+#define BLOCK_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// SSE2 path on x86, plain loops everywhere else
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCK_ENCODER_USE_SSE 1
+#endif
+
+/*****************************************************************
+ * CPU encoders for the BC1, BC3 and BC5 block formats; input is
+ * tightly packed RGBA8, output is one 4x4 block after another in
+ * row-major block order, edge blocks repeat the last row/column
+ *****************************************************************/
+namespace BlockEncoder
+{
+	// bytes of encoded data for an image of the given size
+	size_t encodedSize(int width, int height, int blockBytes);
+
+	// RGB colour, alpha ignored (8 bytes per block)
+	void encodeBC1(const uint8_t* rgba, int width, int height, uint8_t* output);
+	// RGB colour with interpolated alpha (16 bytes per block)
+	void encodeBC3(const uint8_t* rgba, int width, int height, uint8_t* output);
+	// red and green as two independent channels, e.g. normal map x and y (16 bytes per block)
+	void encodeBC5(const uint8_t* rgba, int width, int height, uint8_t* output);
+}
+
+#endif
@@ -0,0 +1,282 @@
+#include "CompressedImage.h"
+#include "BlockEncoder.h"
+
+#include "stb/stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace {
+	const char IMAGE_CACHE_MAGIC[4] = { 'B', 'C', 'N', '\0' };
+	const uint32_t IMAGE_CACHE_VERSION = 1;
+	const uint64_t IMAGE_CACHE_ALIGNMENT = 16;
+
+	uint64_t alignOffset(uint64_t offset)
+	{
+		return (offset + IMAGE_CACHE_ALIGNMENT - 1) & ~(IMAGE_CACHE_ALIGNMENT - 1);
+	}
+
+	const char* cacheSuffix(TextureCompression compression)
+	{
+		switch (compression)
+		{
+		case COMPRESSION_BC1:	return ".bc1";
+		case COMPRESSION_BC3:	return ".bc3";
+		case COMPRESSION_BC5:	return ".bc5";
+		default:				return "";
+		}
+	}
+
+	// 2x2 box filter, odd sizes repeat the last row/column
+	std::vector<uint8_t> downsample(const std::vector<uint8_t>& source, int width, int height, bool normalMap)
+	{
+		int newWidth = std::max(1, width / 2);
+		int newHeight = std::max(1, height / 2);
+		std::vector<uint8_t> result(static_cast<size_t>(newWidth) * newHeight * 4);
+
+		for (int y = 0; y < newHeight; y++)
+		{
+			int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+			for (int x = 0; x < newWidth; x++)
+			{
+				int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+				const uint8_t* p00 = &source[(static_cast<size_t>(y0) * width + x0) * 4];
+				const uint8_t* p01 = &source[(static_cast<size_t>(y0) * width + x1) * 4];
+				const uint8_t* p10 = &source[(static_cast<size_t>(y1) * width + x0) * 4];
+				const uint8_t* p11 = &source[(static_cast<size_t>(y1) * width + x1) * 4];
+				uint8_t* target = &result[(static_cast<size_t>(y) * newWidth + x) * 4];
+
+				for (int c = 0; c < 4; c++)
+					target[c] = static_cast<uint8_t>((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+
+				// averaged normals get shorter, restore unit length
+				if (normalMap)
+				{
+					float n[3];
+					for (int c = 0; c < 3; c++)
+						n[c] = target[c] / 127.5f - 1.0f;
+					float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+					if (length > 0.0f)
+					{
+						for (int c = 0; c < 3; c++)
+							target[c] = static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, (n[c] / length + 1.0f) * 127.5f + 0.5f)));
+					}
+				}
+			}
+		}
+
+		return result;
+	}
+}
+
+CompressedImage::CompressedImage()
+{}
+
+GLenum CompressedImage::getFormat(TextureCompression compression)
+{
+	switch (compression)
+	{
+	case COMPRESSION_BC1:	return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case COMPRESSION_BC3:	return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case COMPRESSION_BC5:	return GL_COMPRESSED_RG_RGTC2;
+	default:				return 0;
+	}
+}
+
+int CompressedImage::getBlockBytes(TextureCompression compression)
+{
+	return compression == COMPRESSION_BC1 ? 8 : 16;
+}
+
+bool CompressedImage::isSupported(TextureCompression compression)
+{
+	// RGTC is core, S3TC is an extension that nearly every desktop driver has
+	if (compression == COMPRESSION_BC5)
+		return true;
+
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+	std::vector<GLint> formats(count);
+	if (count > 0)
+		glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+
+	return std::find(formats.begin(), formats.end(), static_cast<GLint>(getFormat(compression))) != formats.end();
+}
+
+const unsigned char* CompressedImage::getData(int level) const
+{
+	const unsigned char* base = mExternal ? mExternal : mData.data();
+	return base + mLevels[level].offset;
+}
+
+std::string CompressedImage::getCacheFile(const std::string& filename, TextureCompression compression)
+{
+	return filename + cacheSuffix(compression);
+}
+
+bool CompressedImage::load(const std::string& filename, TextureCompression compression)
+{
+	mCompression = compression;
+	mLevels.clear();
+	mData.clear();
+	mFile.close();
+	mExternal = nullptr;
+
+	if (compression == COMPRESSION_NONE)
+		return false;
+
+	// cooked cache sits next to the source image
+	std::string cacheFile = getCacheFile(filename, compression);
+	if (loadCache(cacheFile, filename))
+		return true;
+
+	if (!encode(filename))
+		return false;
+
+	writeCache(cacheFile, filename);
+	return true;
+}
+
+bool CompressedImage::loadCache(const std::string& cacheFile, const std::string& filename)
+{
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	if (!MappedFile::getStamp(filename, sourceSize, sourceTime))
+		return false;
+
+	if (!mFile.open(cacheFile) || mFile.size() < sizeof(CompressedImageHeader))
+		return false;
+
+	// reject caches cooked from another version of the source image
+	CompressedImageHeader header;
+	std::memcpy(&header, mFile.data(), sizeof(header));
+	if (header.sourceSize != sourceSize || header.sourceTime != sourceTime || !parse(mFile.data(), mFile.size()))
+	{
+		mFile.close();
+		return false;
+	}
+
+	return true;
+}
+
+bool CompressedImage::loadCooked(const unsigned char* data, size_t size, TextureCompression compression)
+{
+	mCompression = compression;
+	mLevels.clear();
+	mData.clear();
+	mFile.close();
+	mExternal = nullptr;
+
+	// the source stamp is not checked, archives are cooked ahead of time
+	return parse(data, size);
+}
+
+bool CompressedImage::parse(const unsigned char* data, size_t size)
+{
+	if (size < sizeof(CompressedImageHeader))
+		return false;
+
+	CompressedImageHeader header;
+	std::memcpy(&header, data, sizeof(header));
+
+	// reject data from another version or format
+	uint64_t tableEnd = sizeof(header) + static_cast<uint64_t>(header.numLevels) * sizeof(CompressedLevel);
+	if (std::memcmp(header.magic, IMAGE_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != IMAGE_CACHE_VERSION ||
+		header.compression != static_cast<uint32_t>(mCompression) ||
+		header.numLevels == 0 || tableEnd > size)
+		return false;
+
+	mLevels.resize(header.numLevels);
+	std::memcpy(mLevels.data(), data + sizeof(header), header.numLevels * sizeof(CompressedLevel));
+
+	for (const CompressedLevel& level : mLevels)
+	{
+		if (level.offset + level.size > size)
+		{
+			mLevels.clear();
+			return false;
+		}
+	}
+
+	mExternal = data;
+	return true;
+}
+
+bool CompressedImage::encode(const std::string& filename)
+{
+	// decode as RGBA so every block is 64 bytes, flipped like every other texture by the
+	// flag Texture::initImageLoading() sets before any worker starts
+	int width, height, channels;
+	unsigned char* imageData = stbi_load(filename.c_str(), &width, &height, &channels, 4);
+	if (!imageData)
+		return false;
+
+	std::vector<uint8_t> pixels(imageData, imageData + static_cast<size_t>(width) * height * 4);
+	stbi_image_free(imageData);
+
+	// full chain down to 1x1
+	int numLevels = 1;
+	while ((std::max(width, height) >> numLevels) > 0)
+		numLevels++;
+
+	// lay the data out exactly as the cache file so it can be written as is
+	int blockBytes = getBlockBytes(mCompression);
+	mLevels.resize(numLevels);
+	uint64_t offset = alignOffset(sizeof(CompressedImageHeader) + numLevels * sizeof(CompressedLevel));
+	for (int level = 0; level < numLevels; level++)
+	{
+		CompressedLevel& entry = mLevels[level];
+		entry.width = std::max(1, width >> level);
+		entry.height = std::max(1, height >> level);
+		entry.offset = offset;
+		entry.size = BlockEncoder::encodedSize(entry.width, entry.height, blockBytes);
+		offset = alignOffset(offset + entry.size);
+	}
+	mData.assign(static_cast<size_t>(offset), 0);
+
+	for (int level = 0; level < numLevels; level++)
+	{
+		CompressedLevel& entry = mLevels[level];
+		uint8_t* output = mData.data() + entry.offset;
+
+		switch (mCompression)
+		{
+		case COMPRESSION_BC1:	BlockEncoder::encodeBC1(pixels.data(), entry.width, entry.height, output); break;
+		case COMPRESSION_BC3:	BlockEncoder::encodeBC3(pixels.data(), entry.width, entry.height, output); break;
+		case COMPRESSION_BC5:	BlockEncoder::encodeBC5(pixels.data(), entry.width, entry.height, output); break;
+		default:				break;
+		}
+
+		if (level + 1 < numLevels)
+			pixels = downsample(pixels, entry.width, entry.height, mCompression == COMPRESSION_BC5);
+	}
+
+	return true;
+}
+
+void CompressedImage::writeCache(const std::string& cacheFile, const std::string& filename) const
+{
+	CompressedImageHeader header = {};
+	std::memcpy(header.magic, IMAGE_CACHE_MAGIC, sizeof(header.magic));
+	header.version = IMAGE_CACHE_VERSION;
+	header.compression = static_cast<uint32_t>(mCompression);
+	header.numLevels = static_cast<uint32_t>(mLevels.size());
+	if (!MappedFile::getStamp(filename, header.sourceSize, header.sourceTime))
+		return;
+
+	std::ofstream out(cacheFile, std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		// a read-only media folder just means no cache
+		return;
+	}
+
+	// header and level table, then the level data already in place
+	size_t tableEnd = sizeof(header) + mLevels.size() * sizeof(CompressedLevel);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(mLevels.data()), mLevels.size() * sizeof(CompressedLevel));
+	out.write(reinterpret_cast<const char*>(mData.data()) + tableEnd, mData.size() - tableEnd);
+}
@@ -0,0 +1,94 @@
+#ifndef COMPRESSED_IMAGE_H
+#define COMPRESSED_IMAGE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// S3TC formats are not exposed by the core profile loader
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+enum TextureCompression
+{
+	COMPRESSION_NONE,
+	COMPRESSION_BC1,	// colour
+	COMPRESSION_BC3,	// colour with alpha
+	COMPRESSION_BC5		// two channel, normal map x and y
+};
+
+// header of the cooked texture cache written next to the image (<image>.bc1 etc.)
+struct CompressedImageHeader
+{
+	char magic[4];			// "BCN" followed by a zero byte
+	uint32_t version;
+	uint32_t compression;	// TextureCompression
+	uint32_t numLevels;
+	uint64_t sourceSize;	// size of the source image when the cache was cooked
+	int64_t sourceTime;		// modification time of the source image
+};
+
+// one mip level of the cache, the level table follows the header
+struct CompressedLevel
+{
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset;		// byte offset of the level in the file
+	uint64_t size;
+};
+
+/*****************************************************************
+ * block compressed image with a full mip chain; loads the cooked
+ * cache when it is up to date, otherwise decodes the source,
+ * builds the mips on the CPU, encodes them and writes the cache
+ *****************************************************************/
+class CompressedImage
+{
+public:
+	CompressedImage();
+
+	// non-copyable, may own a file mapping
+	CompressedImage(const CompressedImage&) = delete;
+	CompressedImage& operator=(const CompressedImage&) = delete;
+
+	// does not touch OpenGL, so it can run on a worker thread
+	bool load(const std::string& filename, TextureCompression compression);
+	// use a cooked image already in memory, e.g. an archive entry; the data must stay valid
+	bool loadCooked(const unsigned char* data, size_t size, TextureCompression compression);
+	// name of the cache file written for an image
+	static std::string getCacheFile(const std::string& filename, TextureCompression compression);
+
+	GLenum getFormat() const { return getFormat(mCompression); }
+	int numLevels() const { return static_cast<int>(mLevels.size()); }
+	const CompressedLevel& getLevel(int level) const { return mLevels[level]; }
+	const unsigned char* getData(int level) const;
+
+	static GLenum getFormat(TextureCompression compression);
+	static int getBlockBytes(TextureCompression compression);
+	// true if the driver lists the format as supported
+	static bool isSupported(TextureCompression compression);
+
+private:
+	TextureCompression mCompression = COMPRESSION_NONE;
+	std::vector<CompressedLevel> mLevels;
+
+	// level data lives in the mapped cache or an archive, or in memory after a fresh encode
+	MappedFile mFile;
+	std::vector<unsigned char> mData;
+	const unsigned char* mExternal = nullptr;
+
+	bool loadCache(const std::string& cacheFile, const std::string& filename);
+	bool parse(const unsigned char* data, size_t size);
+	bool encode(const std::string& filename);
+	void writeCache(const std::string& cacheFile, const std::string& filename) const;
+};
+
+#endif
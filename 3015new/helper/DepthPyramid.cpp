@@ -0,0 +1,133 @@
+#include "DepthPyramid.h"
+#include "GLState.h"
+
+#include <algorithm>
+
+namespace {
+	// matches local_size in shader/depthPyramid.comp
+	const GLuint GROUP_SIZE = 8;
+
+	GLuint numGroups(int texels)
+	{
+		return (static_cast<GLuint>(texels) + GROUP_SIZE - 1) / GROUP_SIZE;
+	}
+}
+
+DepthPyramid::DepthPyramid()
+{}
+
+DepthPyramid::~DepthPyramid()
+{
+	release();
+}
+
+void DepthPyramid::release()
+{
+	GLuint textures[] = { mDepthTexture, mPyramid };
+	for (GLuint texture : textures)
+	{
+		if (texture != 0)
+		{
+			GLState::deleteTexture(texture);
+			glDeleteTextures(1, &texture);
+		}
+	}
+	mDepthTexture = 0;
+	mPyramid = 0;
+	mLevelSizes.clear();
+	mValid = false;
+}
+
+void DepthPyramid::resize(int width, int height)
+{
+	release();
+	mDepthWidth = width;
+	mDepthHeight = height;
+
+	// copy of the depth buffer, read with texelFetch
+	glGenTextures(1, &mDepthTexture);
+	GLState::bindTexture(0, GL_TEXTURE_2D, mDepthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	// level 0 is already half size, every level halves again down to 1x1
+	glm::ivec2 size(std::max(width / 2, 1), std::max(height / 2, 1));
+	mLevelSizes.push_back(size);
+	while (size.x > 1 || size.y > 1)
+	{
+		size = glm::max(size / 2, glm::ivec2(1));
+		mLevelSizes.push_back(size);
+	}
+
+	glGenTextures(1, &mPyramid);
+	GLState::bindTexture(0, GL_TEXTURE_2D, mPyramid);
+	glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(mLevelSizes.size()), GL_R32F, mLevelSizes[0].x, mLevelSizes[0].y);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void DepthPyramid::build(GLSLProgram& fromDepth, GLSLProgram& reduce, int width, int height, const glm::mat4& viewProjectionMatrix)
+{
+	// a multisampled depth buffer cannot be copied, culling falls back to the frustum alone
+	GLint sampleBuffers = 0;
+	glGetIntegerv(GL_SAMPLE_BUFFERS, &sampleBuffers);
+	if (sampleBuffers != 0 || width <= 0 || height <= 0)
+	{
+		mValid = false;
+		return;
+	}
+
+	if (width != mDepthWidth || height != mDepthHeight || mPyramid == 0)
+		resize(width, height);
+
+	GLState::bindTexture(0, GL_TEXTURE_2D, mDepthTexture);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+	// level 0 from the depth copy
+	fromDepth.use();
+	fromDepth.setUniform("uDepth", 0);
+	fromDepth.setUniform("uDestination", 1);
+	glBindImageTexture(1, mPyramid, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+	glDispatchCompute(numGroups(mLevelSizes[0].x), numGroups(mLevelSizes[0].y), 1);
+
+	// every further level from the one above, which must be written first
+	reduce.use();
+	reduce.setUniform("uSource", 0);
+	reduce.setUniform("uDestination", 1);
+	for (size_t level = 1; level < mLevelSizes.size(); level++)
+	{
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		glBindImageTexture(0, mPyramid, static_cast<GLint>(level) - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		glBindImageTexture(1, mPyramid, static_cast<GLint>(level), GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute(numGroups(mLevelSizes[level].x), numGroups(mLevelSizes[level].y), 1);
+	}
+
+	// sampled by the next cull pass
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	mViewProjectionMatrix = viewProjectionMatrix;
+	mValid = true;
+}
+
+void DepthPyramid::bind(GLuint unit) const
+{
+	GLState::bindTexture(unit, GL_TEXTURE_2D, mPyramid);
+}
+
+glm::vec2 DepthPyramid::getSize() const
+{
+	return mLevelSizes.empty() ? glm::vec2(1.0f) : glm::vec2(mLevelSizes[0]);
+}
+
+bool DepthPyramid::isSupported()
+{
+#ifdef __APPLE__
+	// macOS stops at OpenGL 4.1
+	return false;
+#else
+	return GLAD_GL_VERSION_4_3 != 0;
+#endif
+}
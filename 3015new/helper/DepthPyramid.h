@@ -0,0 +1,55 @@
+#ifndef DEPTH_PYRAMID_H
+#define DEPTH_PYRAMID_H
+
+#include <vector>
+
+#include "utilities.h"
+
+/*****************************************************************
+ * hierarchical depth buffer: the frame's depth copied into a
+ * texture and reduced by compute shaders to a mip chain that
+ * stores the farthest depth under each texel, for occlusion
+ * tests against what the last frame drew
+ *****************************************************************/
+class DepthPyramid
+{
+public:
+	DepthPyramid();
+	~DepthPyramid();
+
+	// non-copyable, the textures are owned
+	DepthPyramid(const DepthPyramid&) = delete;
+	DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+	// copy the depth buffer of the bound read framebuffer and reduce it; fromDepth and reduce
+	// are shader/depthPyramid.comp with and without FROM_DEPTH defined
+	void build(GLSLProgram& fromDepth, GLSLProgram& reduce, int width, int height, const glm::mat4& viewProjectionMatrix);
+	// forget the last build, e.g. when the frames in between were not recorded
+	void invalidate() { mValid = false; }
+
+	// bind the pyramid for sampling with textureLod
+	void bind(GLuint unit) const;
+
+	bool isValid() const { return mValid; }
+	const glm::mat4& getViewProjectionMatrix() const { return mViewProjectionMatrix; }
+	// level 0 size, half the depth buffer
+	glm::vec2 getSize() const;
+
+	// requires compute shaders and image load/store
+	static bool isSupported();
+
+private:
+	GLuint mDepthTexture = 0;
+	GLuint mPyramid = 0;
+	int mDepthWidth = 0;
+	int mDepthHeight = 0;
+	std::vector<glm::ivec2> mLevelSizes;
+
+	glm::mat4 mViewProjectionMatrix = glm::mat4(1.0f);
+	bool mValid = false;
+
+	void resize(int width, int height);
+	void release();
+};
+
+#endif
@@ -0,0 +1,84 @@
+#include "DepthTarget.h"
+#include "GLState.h"
+
+#include <algorithm>
+
+DepthTarget::DepthTarget()
+{}
+
+DepthTarget::~DepthTarget()
+{
+	release();
+}
+
+void DepthTarget::release()
+{
+	if (mTexture != 0)
+	{
+		GLState::deleteTexture(mTexture);
+		glDeleteTextures(1, &mTexture);
+	}
+	if (mFBO != 0)
+		glDeleteFramebuffers(1, &mFBO);
+	mTexture = 0;
+	mFBO = 0;
+}
+
+void DepthTarget::create(GLenum target, int resolution, int layers)
+{
+	release();
+	mTarget = target;
+	mResolution = std::max(resolution, 1);
+
+	glGenTextures(1, &mTexture);
+	GLState::bindTexture(0, mTarget, mTexture);
+	if (mTarget == GL_TEXTURE_CUBE_MAP)
+	{
+		glTexStorage2D(mTarget, 1, GL_DEPTH_COMPONENT32F, mResolution, mResolution);
+		glTexParameteri(mTarget, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	}
+	else
+		glTexStorage3D(mTarget, 1, GL_DEPTH_COMPONENT32F, mResolution, mResolution, std::max(layers, 1));
+	glTexParameteri(mTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(mTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(mTarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(mTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(mTarget, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(mTarget, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+	// depth only, begin() attaches the layers it renders into
+	glGenFramebuffers(1, &mFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, mTexture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cerr << "Depth target framebuffer is incomplete" << std::endl;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DepthTarget::begin(int layer)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	if (layer < 0)
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, mTexture, 0);
+	else
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, mTexture, 0, layer);
+	glViewport(0, 0, mResolution, mResolution);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	// slope scaled offset against acne on surfaces at grazing angles to the light
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.0f, 4.0f);
+}
+
+void DepthTarget::end(GLuint framebuffer)
+{
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void DepthTarget::bind(GLuint unit) const
+{
+	GLState::bindTexture(unit, mTarget, mTexture);
+}
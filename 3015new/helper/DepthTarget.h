@@ -0,0 +1,45 @@
+#ifndef DEPTH_TARGET_H
+#define DEPTH_TARGET_H
+
+#include "utilities.h"
+
+/*****************************************************************
+ * square depth texture with several layers, either a 2D array
+ * or a cube map, and the depth only framebuffer that renders
+ * into it; sampled with a comparison sampler, so the shadow
+ * lookups built on it are filtered
+ *****************************************************************/
+class DepthTarget
+{
+public:
+	DepthTarget();
+	~DepthTarget();
+
+	// non-copyable, the texture and framebuffer are owned
+	DepthTarget(const DepthTarget&) = delete;
+	DepthTarget& operator=(const DepthTarget&) = delete;
+
+	// (re)allocate as GL_TEXTURE_2D_ARRAY with the given number of layers, or as
+	// GL_TEXTURE_CUBE_MAP whose six faces are the layers
+	void create(GLenum target, int resolution, int layers);
+	void release();
+	bool isCreated() const { return mTexture != 0; }
+
+	// clear and render into one layer, or into all of them at once with gl_Layer
+	// picking one when layer is negative
+	void begin(int layer = -1);
+	// rebind the given framebuffer, the caller restores its viewport
+	void end(GLuint framebuffer);
+
+	void bind(GLuint unit) const;
+
+	int getResolution() const { return mResolution; }
+
+private:
+	GLenum mTarget = GL_TEXTURE_2D_ARRAY;
+	GLuint mTexture = 0;
+	GLuint mFBO = 0;
+	int mResolution = 0;
+};
+
+#endif
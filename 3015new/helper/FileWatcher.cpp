@@ -0,0 +1,95 @@
+#include "FileWatcher.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher()
+{
+#ifdef __linux__
+	mNotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+	if (mNotify >= 0)
+		close(mNotify);
+#endif
+}
+
+void FileWatcher::watch(const std::string& filename)
+{
+	if (mFiles.count(filename))
+		return;
+
+	WatchedFile& file = mFiles[filename];
+	MappedFile::getStamp(filename, file.size, file.time);
+
+#ifdef __linux__
+	// editors often save by renaming over the file, so the directory is watched rather than the file
+	size_t slash = filename.find_last_of('/');
+	std::string directory = slash == std::string::npos ? std::string(".") : filename.substr(0, slash);
+	std::string prefix = slash == std::string::npos ? std::string() : filename.substr(0, slash + 1);
+	if (mNotify >= 0)
+	{
+		int wd = inotify_add_watch(mNotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (wd >= 0)
+			mDirectories[wd] = prefix;
+	}
+#endif
+}
+
+std::vector<std::string> FileWatcher::poll()
+{
+	std::vector<std::string> changed;
+
+#ifdef __linux__
+	// drain every queued event, the descriptor is non-blocking
+	alignas(inotify_event) char buffer[4096];
+	for (;;)
+	{
+		ssize_t length = mNotify >= 0 ? read(mNotify, buffer, sizeof(buffer)) : -1;
+		if (length <= 0)
+			break;
+
+		for (char* p = buffer; p < buffer + length; p += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(p)->len)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+			auto directory = mDirectories.find(event->wd);
+			if (event->len == 0 || directory == mDirectories.end())
+				continue;
+
+			std::string filename = directory->second + event->name;
+			if (mFiles.count(filename) && std::find(changed.begin(), changed.end(), filename) == changed.end())
+				changed.push_back(filename);
+		}
+	}
+#else
+	// a few stat calls twice a second
+	auto now = std::chrono::steady_clock::now();
+	if (now - mLastCheck < std::chrono::milliseconds(500))
+		return changed;
+	mLastCheck = now;
+
+	for (auto& entry : mFiles)
+	{
+		WatchedFile stamp;
+		if (!MappedFile::getStamp(entry.first, stamp.size, stamp.time))
+			continue;
+
+		if (stamp.size != entry.second.size || stamp.time != entry.second.time)
+		{
+			entry.second = stamp;
+			changed.push_back(entry.first);
+		}
+	}
+#endif
+
+	return changed;
+}
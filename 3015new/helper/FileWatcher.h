@@ -0,0 +1,47 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/*****************************************************************
+ * reports files that have been written since the last poll,
+ * via inotify on Linux and by comparing modification times
+ * twice a second elsewhere; polling never blocks
+ *****************************************************************/
+class FileWatcher
+{
+public:
+	FileWatcher();
+	~FileWatcher();
+
+	// non-copyable, the inotify descriptor is owned
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// start watching a file, named the way it is reported back
+	void watch(const std::string& filename);
+	// files changed since the last call, each reported once
+	std::vector<std::string> poll();
+
+private:
+	struct WatchedFile
+	{
+		uint64_t size = 0;
+		int64_t time = 0;
+	};
+
+	std::map<std::string, WatchedFile> mFiles;
+
+#ifdef __linux__
+	int mNotify = -1;
+	std::map<int, std::string> mDirectories;	// watch descriptor to directory prefix
+#else
+	std::chrono::steady_clock::time_point mLastCheck;
+#endif
+};
+
+#endif
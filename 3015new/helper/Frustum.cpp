@@ -0,0 +1,141 @@
+#include "Frustum.h"
+
+#include <cmath>
+
+#ifdef FRUSTUM_USE_SSE
+#include <emmintrin.h>
+#endif
+
+void BoundingBox::expand(const glm::vec3& point)
+{
+	min = glm::min(min, point);
+	max = glm::max(max, point);
+}
+
+BoundingBox BoundingBox::transformed(const glm::mat4& matrix) const
+{
+	// transform the centre and project the extent onto the absolute axes
+	glm::vec3 newCenter = glm::vec3(matrix * glm::vec4(center(), 1.0f));
+	glm::vec3 oldExtent = extent();
+	glm::vec3 newExtent =
+		glm::abs(glm::vec3(matrix[0])) * oldExtent.x +
+		glm::abs(glm::vec3(matrix[1])) * oldExtent.y +
+		glm::abs(glm::vec3(matrix[2])) * oldExtent.z;
+
+	BoundingBox box;
+	box.min = newCenter - newExtent;
+	box.max = newCenter + newExtent;
+	return box;
+}
+
+Frustum::Frustum()
+{
+	// an unextracted frustum accepts everything
+	for (int i = 0; i < 8; i++)
+	{
+		mPlaneX[i] = mPlaneY[i] = mPlaneZ[i] = 0.0f;
+		mPlaneW[i] = 1.0f;
+	}
+}
+
+void Frustum::extract(const glm::mat4& viewProjectionMatrix)
+{
+	// rows of the matrix, glm stores columns
+	const glm::mat4& m = viewProjectionMatrix;
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; i++)
+		row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+	// left, right, bottom, top, near, far
+	glm::vec4 planes[NUM_PLANES] =
+	{
+		row[3] + row[0], row[3] - row[0],
+		row[3] + row[1], row[3] - row[1],
+		row[3] + row[2], row[3] - row[2]
+	};
+
+	for (int i = 0; i < NUM_PLANES; i++)
+	{
+		float length = glm::length(glm::vec3(planes[i]));
+		glm::vec4 plane = length > 0.0f ? planes[i] / length : planes[i];
+
+		mPlaneX[i] = plane.x;
+		mPlaneY[i] = plane.y;
+		mPlaneZ[i] = plane.z;
+		mPlaneW[i] = plane.w;
+	}
+}
+
+bool Frustum::testSphere(const glm::vec3& center, float radius) const
+{
+#ifdef FRUSTUM_USE_SSE
+	__m128 cx = _mm_set1_ps(center.x);
+	__m128 cy = _mm_set1_ps(center.y);
+	__m128 cz = _mm_set1_ps(center.z);
+	__m128 r = _mm_set1_ps(-radius);
+
+	for (int i = 0; i < 8; i += 4)
+	{
+		// signed distance of the centre to four planes at once
+		__m128 distance = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_load_ps(mPlaneX + i), cx), _mm_mul_ps(_mm_load_ps(mPlaneY + i), cy)),
+			_mm_add_ps(_mm_mul_ps(_mm_load_ps(mPlaneZ + i), cz), _mm_load_ps(mPlaneW + i)));
+
+		if (_mm_movemask_ps(_mm_cmplt_ps(distance, r)) != 0)
+			return false;
+	}
+	return true;
+#else
+	for (int i = 0; i < NUM_PLANES; i++)
+	{
+		float distance = mPlaneX[i] * center.x + mPlaneY[i] * center.y + mPlaneZ[i] * center.z + mPlaneW[i];
+		if (distance < -radius)
+			return false;
+	}
+	return true;
+#endif
+}
+
+bool Frustum::testBox(const BoundingBox& box) const
+{
+	glm::vec3 center = box.center();
+	glm::vec3 extent = box.extent();
+
+#ifdef FRUSTUM_USE_SSE
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	__m128 cx = _mm_set1_ps(center.x);
+	__m128 cy = _mm_set1_ps(center.y);
+	__m128 cz = _mm_set1_ps(center.z);
+	__m128 ex = _mm_set1_ps(extent.x);
+	__m128 ey = _mm_set1_ps(extent.y);
+	__m128 ez = _mm_set1_ps(extent.z);
+
+	for (int i = 0; i < 8; i += 4)
+	{
+		__m128 px = _mm_load_ps(mPlaneX + i);
+		__m128 py = _mm_load_ps(mPlaneY + i);
+		__m128 pz = _mm_load_ps(mPlaneZ + i);
+
+		// centre distance plus the box extent projected onto each plane normal
+		__m128 distance = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(px, cx), _mm_mul_ps(py, cy)),
+			_mm_add_ps(_mm_mul_ps(pz, cz), _mm_load_ps(mPlaneW + i)));
+		__m128 reach = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, px), ex), _mm_mul_ps(_mm_andnot_ps(signMask, py), ey)),
+			_mm_mul_ps(_mm_andnot_ps(signMask, pz), ez));
+
+		if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, reach), _mm_setzero_ps())) != 0)
+			return false;
+	}
+	return true;
+#else
+	for (int i = 0; i < NUM_PLANES; i++)
+	{
+		float distance = mPlaneX[i] * center.x + mPlaneY[i] * center.y + mPlaneZ[i] * center.z + mPlaneW[i];
+		float reach = std::fabs(mPlaneX[i]) * extent.x + std::fabs(mPlaneY[i]) * extent.y + std::fabs(mPlaneZ[i]) * extent.z;
+		if (distance + reach < 0.0f)
+			return false;
+	}
+	return true;
+#endif
+}
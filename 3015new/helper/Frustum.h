@@ -0,0 +1,57 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+// SSE path on x86, plain loops everywhere else
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_USE_SSE 1
+#endif
+
+// axis aligned bounding box with its bounding sphere
+struct BoundingBox
+{
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 max = glm::vec3(0.0f);
+
+	glm::vec3 center() const { return (min + max) * 0.5f; }
+	glm::vec3 extent() const { return (max - min) * 0.5f; }
+	float radius() const { return glm::length(extent()); }
+
+	// grow to contain a point, the first point should be assigned to min and max
+	void expand(const glm::vec3& point);
+	// box enclosing this box after transformation to world space
+	BoundingBox transformed(const glm::mat4& matrix) const;
+};
+
+/*****************************************************************
+ * six clip planes extracted from a view-projection matrix;
+ * planes are kept in structure-of-arrays form so four planes are
+ * tested against a volume with one SIMD operation
+ *****************************************************************/
+class Frustum
+{
+public:
+	Frustum();
+
+	// extract normalised planes, inside is the positive half-space
+	void extract(const glm::mat4& viewProjectionMatrix);
+
+	// true when the volume is at least partly inside
+	bool testSphere(const glm::vec3& center, float radius) const;
+	bool testBox(const BoundingBox& box) const;
+
+	// plane as (normal, distance), e.g. for a shader
+	glm::vec4 getPlane(int index) const { return glm::vec4(mPlaneX[index], mPlaneY[index], mPlaneZ[index], mPlaneW[index]); }
+
+	static const int NUM_PLANES = 6;
+
+private:
+	// padded to eight planes, the two extra planes always pass
+	alignas(16) float mPlaneX[8];
+	alignas(16) float mPlaneY[8];
+	alignas(16) float mPlaneZ[8];
+	alignas(16) float mPlaneW[8];
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "GBuffer.h"
+#include "GLState.h"
+
+namespace {
+	GLuint createTarget(GLenum format, int width, int height)
+	{
+		// read with texelFetch, never filtered
+		GLuint texture = 0;
+		glGenTextures(1, &texture);
+		GLState::bindTexture(0, GL_TEXTURE_2D, texture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		return texture;
+	}
+}
+
+GBuffer::GBuffer()
+{}
+
+GBuffer::~GBuffer()
+{
+	release();
+}
+
+void GBuffer::release()
+{
+	GLuint textures[] = { mAlbedoTexture, mNormalTexture, mDepthTexture };
+	for (GLuint texture : textures)
+	{
+		if (texture != 0)
+		{
+			GLState::deleteTexture(texture);
+			glDeleteTextures(1, &texture);
+		}
+	}
+	if (mFBO != 0)
+		glDeleteFramebuffers(1, &mFBO);
+	if (mVAO != 0)
+	{
+		GLState::deleteVertexArray(mVAO);
+		glDeleteVertexArrays(1, &mVAO);
+	}
+	mAlbedoTexture = 0;
+	mNormalTexture = 0;
+	mDepthTexture = 0;
+	mFBO = 0;
+	mVAO = 0;
+}
+
+void GBuffer::resize(int width, int height)
+{
+	release();
+	mWidth = width;
+	mHeight = height;
+
+	mAlbedoTexture = createTarget(GL_RGBA8, width, height);
+	mNormalTexture = createTarget(GL_RGB10_A2, width, height);
+	// the depth copy requires the target's format, the usual one for depth with stencil
+	mDepthTexture = createTarget(GL_DEPTH24_STENCIL8, width, height);
+
+	glGenFramebuffers(1, &mFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mAlbedoTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, mNormalTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, mDepthTexture, 0);
+	GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cerr << "G-buffer framebuffer is incomplete" << std::endl;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glGenVertexArrays(1, &mVAO);
+}
+
+void GBuffer::begin(int width, int height)
+{
+	if (width != mWidth || height != mHeight || mFBO == 0)
+		resize(width, height);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glViewport(0, 0, mWidth, mHeight);
+
+	// zero coverage marks the pixels nothing was drawn to, whatever the clear colour is
+	const GLfloat zero[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	glClearBufferfv(GL_COLOR, 0, zero);
+	glClearBufferfv(GL_COLOR, 1, zero);
+	glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+}
+
+void GBuffer::resolve(GLSLProgram& lighting, const glm::mat4& viewProjectionMatrix, GLuint framebuffer)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+	GLState::bindTexture(ALBEDO_UNIT, GL_TEXTURE_2D, mAlbedoTexture);
+	GLState::bindTexture(NORMAL_UNIT, GL_TEXTURE_2D, mNormalTexture);
+	GLState::bindTexture(DEPTH_UNIT, GL_TEXTURE_2D, mDepthTexture);
+
+	lighting.use();
+	lighting.setUniform("uGBufferAlbedo", static_cast<int>(ALBEDO_UNIT));
+	lighting.setUniform("uGBufferNormal", static_cast<int>(NORMAL_UNIT));
+	lighting.setUniform("uGBufferDepth", static_cast<int>(DEPTH_UNIT));
+	lighting.setUniform("uInverseViewProjectionMatrix", glm::inverse(viewProjectionMatrix));
+
+	// one triangle over the viewport, nothing to depth test against
+	glDisable(GL_DEPTH_TEST);
+	GLState::bindVertexArray(mVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glEnable(GL_DEPTH_TEST);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, mFBO);
+	glBlitFramebuffer(0, 0, mWidth, mHeight, 0, 0, mWidth, mHeight, GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+bool GBuffer::isSupported()
+{
+	GLint sampleBuffers = 0;
+	glGetIntegerv(GL_SAMPLE_BUFFERS, &sampleBuffers);
+	return sampleBuffers == 0;
+}
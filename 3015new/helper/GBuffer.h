@@ -0,0 +1,54 @@
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include "utilities.h"
+
+/*****************************************************************
+ * geometry buffer of the deferred path: albedo with a specular
+ * intensity (RGBA8) and an octahedral normal with the shininess
+ * (RGB10_A2), 8 bytes a pixel besides depth; lit afterwards by a
+ * full-screen pass that shades every pixel once, however many
+ * fragments were drawn over it
+ *****************************************************************/
+class GBuffer
+{
+public:
+	// texture units of the lighting pass, the shadow maps stay bound on the units between
+	static const GLuint ALBEDO_UNIT = 0;
+	static const GLuint NORMAL_UNIT = 1;
+	static const GLuint DEPTH_UNIT = 4;
+
+	GBuffer();
+	~GBuffer();
+
+	// non-copyable, the textures and framebuffer are owned
+	GBuffer(const GBuffer&) = delete;
+	GBuffer& operator=(const GBuffer&) = delete;
+
+	// render into the G-buffer, (re)allocated when the size changes
+	void begin(int width, int height);
+	// light every covered pixel into framebuffer with a DEFERRED variant of shader/phong.*,
+	// then copy the depth across so forward objects can be drawn on top; framebuffer is
+	// left bound
+	void resolve(GLSLProgram& lighting, const glm::mat4& viewProjectionMatrix, GLuint framebuffer);
+
+	bool isCreated() const { return mFBO != 0; }
+
+	// the depth copy needs a single-sampled target, so this checks the framebuffer bound
+	// now, which should be the one later passed to resolve()
+	static bool isSupported();
+
+private:
+	GLuint mAlbedoTexture = 0;
+	GLuint mNormalTexture = 0;
+	GLuint mDepthTexture = 0;
+	GLuint mFBO = 0;
+	GLuint mVAO = 0;		// empty, the full-screen triangle is generated in the shader
+	int mWidth = 0;
+	int mHeight = 0;
+
+	void resize(int width, int height);
+	void release();
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include "GLState.h"
+
+#include <cstdio>
+
+namespace {
+	const GLuint UNKNOWN = ~0u;
+}
+
+GLuint GLState::sProgram = UNKNOWN;
+GLuint GLState::sVertexArray = UNKNOWN;
+// a new context starts on unit 0 with nothing bound
+GLuint GLState::sActiveUnit = 0;
+GLuint GLState::sTextures[MAX_TEXTURE_UNITS][NUM_TARGET_SLOTS] = {};
+
+unsigned long long GLState::sIssued = 0;
+unsigned long long GLState::sElided = 0;
+
+int GLState::targetSlot(GLenum target)
+{
+	switch (target)
+	{
+	case GL_TEXTURE_2D:			return SLOT_2D;
+	case GL_TEXTURE_CUBE_MAP:	return SLOT_CUBE_MAP;
+	case GL_TEXTURE_2D_ARRAY:	return SLOT_2D_ARRAY;
+	default:					return -1;
+	}
+}
+
+void GLState::useProgram(GLuint program)
+{
+	if (program == sProgram)
+	{
+		sElided++;
+		return;
+	}
+
+	glUseProgram(program);
+	sProgram = program;
+	sIssued++;
+}
+
+void GLState::bindVertexArray(GLuint vao)
+{
+	if (vao == sVertexArray)
+	{
+		sElided++;
+		return;
+	}
+
+	glBindVertexArray(vao);
+	sVertexArray = vao;
+	sIssued++;
+}
+
+void GLState::activeTexture(GLuint unit)
+{
+	if (unit == sActiveUnit)
+	{
+		sElided++;
+		return;
+	}
+
+	glActiveTexture(GL_TEXTURE0 + unit);
+	sActiveUnit = unit;
+	sIssued++;
+}
+
+void GLState::bindTexture(GLenum target, GLuint texture)
+{
+	int slot = targetSlot(target);
+
+	// untracked targets and units beyond the shadow table are always issued
+	if (slot < 0 || sActiveUnit >= MAX_TEXTURE_UNITS)
+	{
+		glBindTexture(target, texture);
+		sIssued++;
+
+		// with the unit unknown any tracked binding of this target may have changed
+		if (slot >= 0 && sActiveUnit == UNKNOWN)
+		{
+			for (auto& unit : sTextures)
+				unit[slot] = UNKNOWN;
+		}
+		return;
+	}
+
+	if (sTextures[sActiveUnit][slot] == texture)
+	{
+		sElided++;
+		return;
+	}
+
+	glBindTexture(target, texture);
+	sTextures[sActiveUnit][slot] = texture;
+	sIssued++;
+}
+
+void GLState::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+	int slot = targetSlot(target);
+
+	// check the binding first so an unchanged unit costs no glActiveTexture either
+	if (slot >= 0 && unit < MAX_TEXTURE_UNITS && sTextures[unit][slot] == texture)
+	{
+		sElided++;
+		return;
+	}
+
+	activeTexture(unit);
+	bindTexture(target, texture);
+}
+
+void GLState::deleteProgram(GLuint program)
+{
+	if (program == sProgram)
+		sProgram = UNKNOWN;
+}
+
+void GLState::deleteVertexArray(GLuint vao)
+{
+	if (vao == sVertexArray)
+		sVertexArray = UNKNOWN;
+}
+
+void GLState::deleteTexture(GLuint texture)
+{
+	for (auto& unit : sTextures)
+	{
+		for (GLuint& binding : unit)
+		{
+			if (binding == texture)
+				binding = UNKNOWN;
+		}
+	}
+}
+
+void GLState::invalidate()
+{
+	sProgram = UNKNOWN;
+	sVertexArray = UNKNOWN;
+	sActiveUnit = UNKNOWN;
+
+	for (auto& unit : sTextures)
+	{
+		for (GLuint& binding : unit)
+			binding = UNKNOWN;
+	}
+}
+
+void GLState::resetCounters()
+{
+	sIssued = 0;
+	sElided = 0;
+}
+
+void GLState::print()
+{
+	unsigned long long total = sIssued + sElided;
+	printf("GL state: %llu binds issued, %llu elided (%.1f%%)\n", sIssued, sElided,
+		total > 0 ? 100.0 * sElided / total : 0.0);
+}
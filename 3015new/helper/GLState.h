@@ -0,0 +1,55 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+/*****************************************************************
+ * shadows the bound program, VAO, active texture unit and the
+ * per-unit texture bindings so redundant binds are never sent
+ * to the driver; all binds of these objects must go through here
+ *****************************************************************/
+class GLState
+{
+public:
+	// bind calls, skipped when the object is already bound
+	static void useProgram(GLuint program);
+	static void bindVertexArray(GLuint vao);
+	static void activeTexture(GLuint unit);
+	static void bindTexture(GLenum target, GLuint texture);
+	// activeTexture followed by bindTexture
+	static void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+	// forget a deleted object so a recycled name is bound again
+	static void deleteProgram(GLuint program);
+	static void deleteVertexArray(GLuint vao);
+	static void deleteTexture(GLuint texture);
+
+	// mark everything unknown, e.g. after code that binds directly
+	static void invalidate();
+
+	// calls sent to the driver and calls dropped as redundant
+	static unsigned long long getIssued() { return sIssued; }
+	static unsigned long long getElided() { return sElided; }
+	static void resetCounters();
+	// print counters to stdout
+	static void print();
+
+	static const int MAX_TEXTURE_UNITS = 16;
+
+private:
+	// texture targets that are tracked per unit
+	enum TargetSlot { SLOT_2D, SLOT_CUBE_MAP, SLOT_2D_ARRAY, NUM_TARGET_SLOTS };
+
+	static int targetSlot(GLenum target);
+
+	// ~0u means unknown, so the first bind is always issued
+	static GLuint sProgram;
+	static GLuint sVertexArray;
+	static GLuint sActiveUnit;
+	static GLuint sTextures[MAX_TEXTURE_UNITS][NUM_TARGET_SLOTS];
+
+	static unsigned long long sIssued;
+	static unsigned long long sElided;
+};
+
+#endif
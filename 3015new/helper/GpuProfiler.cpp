@@ -0,0 +1,131 @@
+#include "GpuProfiler.h"
+
+#include <cstdio>
+
+GpuProfiler::GpuProfiler()
+{}
+
+GpuProfiler::~GpuProfiler()
+{
+	// delete query objects
+	for (Scope& scope : mScopes)
+		glDeleteQueries(FRAME_LATENCY * 2, &scope.queries[0][0]);
+}
+
+void GpuProfiler::beginFrame()
+{
+	mFrame++;
+	int slot = mFrame % FRAME_LATENCY;
+
+	// the slot about to be reused was issued FRAME_LATENCY frames ago
+	for (Scope& scope : mScopes)
+	{
+		if (!scope.pending[slot])
+			continue;
+
+		GLint available = 0;
+		glGetQueryObjectiv(scope.queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+		// a GPU that is still further behind drops the sample instead of stalling
+		if (available)
+		{
+			GLuint64 begin = 0, end = 0;
+			glGetQueryObjectui64v(scope.queries[slot][0], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(scope.queries[slot][1], GL_QUERY_RESULT, &end);
+			addSample(scope, (end - begin) / 1.0e6);
+		}
+
+		scope.pending[slot] = false;
+	}
+
+	mOpenScopes.clear();
+}
+
+void GpuProfiler::beginScope(const char* name)
+{
+	auto it = mScopeIndex.find(name);
+	int index;
+
+	if (it == mScopeIndex.end())
+	{
+		// first use of this scope, create its query ring
+		index = static_cast<int>(mScopes.size());
+		mScopes.emplace_back();
+		mScopes.back().name = name;
+		glGenQueries(FRAME_LATENCY * 2, &mScopes.back().queries[0][0]);
+		mScopeIndex[name] = index;
+	}
+	else
+	{
+		index = it->second;
+	}
+
+	int slot = mFrame % FRAME_LATENCY;
+	Scope& scope = mScopes[index];
+
+	// a scope used twice in one frame keeps only its first timing
+	if (scope.pending[slot])
+	{
+		mOpenScopes.push_back(-1);
+		return;
+	}
+
+	glQueryCounter(scope.queries[slot][0], GL_TIMESTAMP);
+	mOpenScopes.push_back(index);
+}
+
+void GpuProfiler::endScope()
+{
+	if (mOpenScopes.empty())
+		return;
+
+	int index = mOpenScopes.back();
+	mOpenScopes.pop_back();
+	if (index < 0)
+		return;
+
+	int slot = mFrame % FRAME_LATENCY;
+	Scope& scope = mScopes[index];
+
+	glQueryCounter(scope.queries[slot][1], GL_TIMESTAMP);
+	scope.pending[slot] = true;
+}
+
+double GpuProfiler::getAverage(const std::string& name) const
+{
+	auto it = mScopeIndex.find(name);
+	if (it == mScopeIndex.end())
+		return 0.0;
+
+	const Scope& scope = mScopes[it->second];
+	return scope.historyCount > 0 ? scope.historySum / scope.historyCount : 0.0;
+}
+
+std::vector<std::pair<std::string, double>> GpuProfiler::getAverages() const
+{
+	std::vector<std::pair<std::string, double>> averages;
+	for (const Scope& scope : mScopes)
+		averages.emplace_back(scope.name, getAverage(scope.name));
+
+	return averages;
+}
+
+void GpuProfiler::print() const
+{
+	printf("GPU time (average of last %d frames):\n", HISTORY_SIZE);
+	for (const auto& average : getAverages())
+		printf("  %-12s %8.3f ms\n", average.first.c_str(), average.second);
+}
+
+void GpuProfiler::addSample(Scope& scope, double milliseconds)
+{
+	// replace the oldest sample once the history is full
+	if (scope.historyCount == HISTORY_SIZE)
+		scope.historySum -= scope.history[scope.historyIndex];
+	else
+		scope.historyCount++;
+
+	scope.history[scope.historyIndex] = milliseconds;
+	scope.historySum += milliseconds;
+	scope.historyIndex = (scope.historyIndex + 1) % HISTORY_SIZE;
+}
@@ -0,0 +1,76 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <glad/glad.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*****************************************************************
+ * GPU timer built on GL_TIMESTAMP queries; each named scope owns
+ * a ring of query pairs so results are read frames later without
+ * stalling, and exposes a rolling average per scope
+ *****************************************************************/
+class GpuProfiler
+{
+public:
+	GpuProfiler();
+	~GpuProfiler();
+
+	// non-copyable, the query objects are owned
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	// collect results that have become available and advance the ring
+	void beginFrame();
+	// scopes may nest, every beginScope needs a matching endScope
+	void beginScope(const char* name);
+	void endScope();
+
+	// rolling average of a scope in milliseconds, 0 if unknown
+	double getAverage(const std::string& name) const;
+	// (name, average ms) for every scope in first-use order
+	std::vector<std::pair<std::string, double>> getAverages() const;
+	// print rolling averages to stdout
+	void print() const;
+
+	static const int FRAME_LATENCY = 4;		// frames a query pair stays in flight
+	static const int HISTORY_SIZE = 60;		// frames in the rolling average
+
+private:
+	struct Scope
+	{
+		std::string name;
+		GLuint queries[FRAME_LATENCY][2] = {};	// begin and end timestamps
+		bool pending[FRAME_LATENCY] = {};
+		double history[HISTORY_SIZE] = {};
+		int historyCount = 0;
+		int historyIndex = 0;
+		double historySum = 0.0;
+	};
+
+	std::vector<Scope> mScopes;
+	std::map<std::string, int> mScopeIndex;
+	std::vector<int> mOpenScopes;
+	int mFrame = 0;
+
+	void addSample(Scope& scope, double milliseconds);
+};
+
+// begins a profiler scope for the lifetime of the object
+class GpuScope
+{
+public:
+	GpuScope(GpuProfiler& profiler, const char* name) : mProfiler(profiler) { mProfiler.beginScope(name); }
+	~GpuScope() { mProfiler.endScope(); }
+
+	GpuScope(const GpuScope&) = delete;
+	GpuScope& operator=(const GpuScope&) = delete;
+
+private:
+	GpuProfiler& mProfiler;
+};
+
+#endif
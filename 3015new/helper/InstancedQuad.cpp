@@ -0,0 +1,157 @@
+#include "InstancedQuad.h"
+#include "GLState.h"
+
+#include <cstring>
+
+InstancedQuad::InstancedQuad()
+{}
+
+InstancedQuad::~InstancedQuad()
+{
+	// delete buffers
+	if (mVBO != 0)
+		glDeleteBuffers(1, &mVBO);
+	if (mInstanceVBO != 0)
+		glDeleteBuffers(1, &mInstanceVBO);
+	if (mVAO != 0)
+	{
+		GLState::deleteVertexArray(mVAO);
+		glDeleteVertexArrays(1, &mVAO);
+	}
+}
+
+int InstancedQuad::addInstance(const glm::mat4& modelMatrix)
+{
+	InstanceMatrices instance;	// for instance data
+
+	// the normal matrix is constant for a static instance, so compute it once here
+	glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(modelMatrix)));
+
+	std::memcpy(instance.modelMatrix, &modelMatrix[0][0], sizeof(instance.modelMatrix));
+	std::memcpy(instance.normalMatrix, &normalMatrix[0][0], sizeof(instance.normalMatrix));
+
+	mInstances.push_back(instance);
+
+	// the quad spans [-1, 1] in x and y on the z = 0 plane
+	BoundingBox quadBounds;
+	quadBounds.min = glm::vec3(-1.0f, -1.0f, 0.0f);
+	quadBounds.max = glm::vec3(1.0f, 1.0f, 0.0f);
+	mBounds.push_back(quadBounds.transformed(modelMatrix));
+
+	return static_cast<int>(mInstances.size()) - 1;
+}
+
+void InstancedQuad::create()
+{
+	// vertex positions, normals, tangents and texture coordinates
+	std::vector<GLfloat> vertices =
+	{
+		-1.0f, -1.0f, 0.0f,	// vertex 0: position
+		0.0f, 0.0f, 1.0f,	// vertex 0: normal
+		1.0f, 0.0f, 0.0f,	// vertex 0: tangent
+		0.0f, 0.0f,			// vertex 0: texture coordinate
+		1.0f, -1.0f, 0.0f,	// vertex 1: position
+		0.0f, 0.0f, 1.0f,	// vertex 1: normal
+		1.0f, 0.0f, 0.0f,	// vertex 1: tangent
+		1.0f, 0.0f,			// vertex 1: texture coordinate
+		-1.0f, 1.0f, 0.0f,	// vertex 2: position
+		0.0f, 0.0f, 1.0f,	// vertex 2: normal
+		1.0f, 0.0f, 0.0f,	// vertex 2: tangent
+		0.0f, 1.0f,			// vertex 2: texture coordinate
+		1.0f, 1.0f, 0.0f,	// vertex 3: position
+		0.0f, 0.0f, 1.0f,	// vertex 3: normal
+		1.0f, 0.0f, 0.0f,	// vertex 3: tangent
+		1.0f, 1.0f,			// vertex 3: texture coordinate
+	};
+
+	// create VBO
+	glGenBuffers(1, &mVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+
+	// create instance VBO
+	glGenBuffers(1, &mInstanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceMatrices) * mInstances.size(), mInstances.data(), GL_DYNAMIC_DRAW);
+
+	// everything is visible until the first cull
+	mVisibleIndices.resize(mInstances.size());
+	for (size_t i = 0; i < mInstances.size(); i++)
+		mVisibleIndices[i] = static_cast<int>(i);
+
+	// create VAO, specify VBO data and format of the data
+	glGenVertexArrays(1, &mVAO);
+	GLState::bindVertexArray(mVAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormTanTex),
+		reinterpret_cast<void*>(offsetof(VertexNormTanTex, position)));		// specify format of position data
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormTanTex),
+		reinterpret_cast<void*>(offsetof(VertexNormTanTex, normal)));		// specify format of normal data
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormTanTex),
+		reinterpret_cast<void*>(offsetof(VertexNormTanTex, tangent)));		// specify format of tangent data
+	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(VertexNormTanTex),
+		reinterpret_cast<void*>(offsetof(VertexNormTanTex, texCoord)));		// specify format of texture coordinate data
+
+	glEnableVertexAttribArray(0);	// enable vertex attributes
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glEnableVertexAttribArray(3);
+
+	// model matrix occupies locations 4-7 and normal matrix locations 8-10, one column each
+	glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+	for (GLuint i = 0; i < 4; i++)
+	{
+		glVertexAttribPointer(4 + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceMatrices),
+			reinterpret_cast<void*>(offsetof(InstanceMatrices, modelMatrix) + sizeof(GLfloat) * 4 * i));
+		glVertexAttribDivisor(4 + i, 1);	// advance once per instance
+		glEnableVertexAttribArray(4 + i);
+	}
+	for (GLuint i = 0; i < 3; i++)
+	{
+		glVertexAttribPointer(8 + i, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceMatrices),
+			reinterpret_cast<void*>(offsetof(InstanceMatrices, normalMatrix) + sizeof(GLfloat) * 3 * i));
+		glVertexAttribDivisor(8 + i, 1);
+		glEnableVertexAttribArray(8 + i);
+	}
+
+	// unbind VAO
+	GLState::bindVertexArray(0);
+}
+
+int InstancedQuad::cull(const Frustum& frustum)
+{
+	mCullScratch.clear();
+	for (size_t i = 0; i < mBounds.size(); i++)
+	{
+		if (frustum.testBox(mBounds[i]))
+			mCullScratch.push_back(static_cast<int>(i));
+	}
+
+	// only re-upload when the visible set changed, a still camera costs nothing
+	if (mCullScratch != mVisibleIndices)
+	{
+		mVisibleIndices.swap(mCullScratch);
+
+		mVisibleInstances.resize(mVisibleIndices.size());
+		for (size_t i = 0; i < mVisibleIndices.size(); i++)
+			mVisibleInstances[i] = mInstances[mVisibleIndices[i]];
+
+		if (mInstanceVBO != 0 && !mVisibleInstances.empty())
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(InstanceMatrices) * mVisibleInstances.size(), mVisibleInstances.data());
+		}
+	}
+
+	return numVisible();
+}
+
+void InstancedQuad::draw()
+{
+	if (mVAO != 0 && !mVisibleIndices.empty())
+	{
+		GLState::bindVertexArray(mVAO);		// make VAO active
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(mVisibleIndices.size()));	// render visible instances
+	}
+}
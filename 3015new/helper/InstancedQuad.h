@@ -0,0 +1,45 @@
+#ifndef INSTANCED_QUAD_H
+#define INSTANCED_QUAD_H
+
+#include "utilities.h"
+#include "Frustum.h"
+
+/*****************************************************************
+ * textured quad drawn once per instance from a per-instance
+ * buffer of model and normal matrices
+ *****************************************************************/
+class InstancedQuad
+{
+public:
+	InstancedQuad();
+	~InstancedQuad();
+
+	// add an instance and return its index
+	int addInstance(const glm::mat4& modelMatrix);
+	// create the quad geometry and upload the instance matrices
+	void create();
+	// keep only instances inside the frustum, returns the visible count
+	int cull(const Frustum& frustum);
+	// render the visible instances with a single draw call
+	void draw();
+
+	int numInstances() const { return static_cast<int>(mInstances.size()); }
+	int numVisible() const { return static_cast<int>(mVisibleIndices.size()); }
+
+private:
+	// OpenGL buffer objects
+	GLuint mVBO = 0;
+	GLuint mInstanceVBO = 0;
+	GLuint mVAO = 0;
+
+	// per-instance matrices and world space bounds
+	std::vector<InstanceMatrices> mInstances;
+	std::vector<BoundingBox> mBounds;
+
+	// instances that passed the last cull, packed at the front of the instance VBO
+	std::vector<int> mVisibleIndices;
+	std::vector<int> mCullScratch;
+	std::vector<InstanceMatrices> mVisibleInstances;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "LightClusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// matches local_size_x in shader/lightCluster.comp
+	const GLuint CLUSTER_GROUP_SIZE = 64;
+}
+
+LightClusters::LightClusters()
+{}
+
+LightClusters::~LightClusters()
+{
+	// delete buffers
+	GLuint buffers[] = { mLightBuffer, mCountBuffer, mIndexBuffer };
+	for (GLuint buffer : buffers)
+	{
+		if (buffer != 0)
+			glDeleteBuffers(1, &buffer);
+	}
+}
+
+void LightClusters::create()
+{
+	mClusterBuffer.create(sizeof(ClusterBlock), CLUSTER_BLOCK_BINDING);
+
+	// lights are replaced every frame, cluster contents are only ever written by the GPU
+	glGenBuffers(1, &mLightBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mLightBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Light::Block) * MAX_LIGHTS, nullptr, GL_DYNAMIC_DRAW);
+
+	glGenBuffers(1, &mCountBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mCountBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * NUM_CLUSTERS, nullptr, GL_DYNAMIC_COPY);
+
+	glGenBuffers(1, &mIndexBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mIndexBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * NUM_CLUSTERS * MAX_CLUSTER_LIGHTS, nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	mBlocks.reserve(MAX_LIGHTS);
+}
+
+void LightClusters::update(const std::vector<Light>& lights, const glm::mat4& projectionMatrix, int width, int height)
+{
+	if (!isCreated())
+		return;
+
+	mNumLights = std::min(static_cast<int>(lights.size()), MAX_LIGHTS);
+	mBlocks.clear();
+	for (int i = 0; i < mNumLights; i++)
+		mBlocks.push_back(lights[i].toBlock());
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mLightBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Light::Block) * mBlocks.size(), mBlocks.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// near and far planes of a perspective projection
+	float nearPlane = projectionMatrix[3][2] / (projectionMatrix[2][2] - 1.0f);
+	float farPlane = projectionMatrix[3][2] / (projectionMatrix[2][2] + 1.0f);
+
+	// slice = log(depth) * scale + bias puts the near plane at 0 and the far plane at CLUSTERS_Z
+	float logRange = std::log(farPlane / nearPlane);
+
+	ClusterBlock block;
+	block.inverseProjectionMatrix = glm::inverse(projectionMatrix);
+	block.grid = glm::uvec4(CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z, mNumLights);
+	block.tile = glm::vec4(
+		static_cast<float>(std::max(width, 1)) / CLUSTERS_X,
+		static_cast<float>(std::max(height, 1)) / CLUSTERS_Y,
+		CLUSTERS_Z / logRange,
+		-CLUSTERS_Z * std::log(nearPlane) / logRange);
+	block.depth = glm::vec4(nearPlane, farPlane, 0.0f, 0.0f);
+	mClusterBuffer.update(&block, sizeof(block));
+}
+
+void LightClusters::build(GLSLProgram& program)
+{
+	if (!isCreated())
+		return;
+
+	mClusterBuffer.bind();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BINDING, mLightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_COUNT_BINDING, mCountBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_INDEX_BINDING, mIndexBuffer);
+
+	program.use();
+	glDispatchCompute((NUM_CLUSTERS + CLUSTER_GROUP_SIZE - 1) / CLUSTER_GROUP_SIZE, 1, 1);
+
+	// the lighting shaders read the clusters as storage buffers
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+bool LightClusters::isSupported()
+{
+#ifdef __APPLE__
+	// macOS stops at OpenGL 4.1
+	return false;
+#else
+	return GLAD_GL_VERSION_4_3 != 0;
+#endif
+}
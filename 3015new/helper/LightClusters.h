@@ -0,0 +1,69 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <vector>
+
+#include "utilities.h"
+#include "UniformBuffer.h"
+
+// cluster grid parameters block (std140), matches ClusterBlock in the shaders
+struct ClusterBlock
+{
+	glm::mat4 inverseProjectionMatrix;
+	glm::uvec4 grid;		// clusters across, down and in depth, number of lights
+	glm::vec4 tile;			// tile width and height in pixels, depth slice scale and bias
+	glm::vec4 depth;		// near and far plane
+};
+
+static_assert(sizeof(ClusterBlock) == 112, "ClusterBlock must match the std140 layout");
+
+/*****************************************************************
+ * clustered forward lighting: lights are kept in a storage
+ * buffer and a compute pass bins them into a grid of screen
+ * tiles by exponential depth slices every frame, so a fragment
+ * only iterates the lights that can reach its cluster
+ *****************************************************************/
+class LightClusters
+{
+public:
+	// grid size, depth slices grow exponentially from the near plane
+	static const int CLUSTERS_X = 16;
+	static const int CLUSTERS_Y = 9;
+	static const int CLUSTERS_Z = 24;
+	static const int NUM_CLUSTERS = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+	// matches MAX_CLUSTER_LIGHTS in the shaders, further lights in a cluster are dropped
+	static const int MAX_CLUSTER_LIGHTS = 128;
+	static const int MAX_LIGHTS = 1024;
+
+	LightClusters();
+	~LightClusters();
+
+	// non-copyable, the buffers are owned
+	LightClusters(const LightClusters&) = delete;
+	LightClusters& operator=(const LightClusters&) = delete;
+
+	// allocate the light and cluster buffers and attach them to their binding points
+	void create();
+	bool isCreated() const { return mLightBuffer != 0; }
+
+	// upload the lights, at most MAX_LIGHTS, and the grid for a perspective projection
+	void update(const std::vector<Light>& lights, const glm::mat4& projectionMatrix, int width, int height);
+	// bin the lights with shader/lightCluster.comp, which reads the view matrix from the frame block
+	void build(GLSLProgram& program);
+
+	int numLights() const { return mNumLights; }
+
+	// requires compute shaders and storage buffers
+	static bool isSupported();
+
+private:
+	UniformBuffer mClusterBuffer;
+	GLuint mLightBuffer = 0;
+	GLuint mCountBuffer = 0;
+	GLuint mIndexBuffer = 0;
+	int mNumLights = 0;
+
+	std::vector<Light::Block> mBlocks;		// upload scratch space
+};
+
+#endif
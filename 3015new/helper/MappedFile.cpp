@@ -0,0 +1,116 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <sys/stat.h>
+
+MappedFile::MappedFile()
+{}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::getStamp(const std::string& filename, uint64_t& size, int64_t& time)
+{
+	struct stat info;
+	if (stat(filename.c_str(), &info) != 0)
+		return false;
+
+	size = static_cast<uint64_t>(info.st_size);
+	time = static_cast<int64_t>(info.st_mtime);
+	return true;
+}
+
+bool MappedFile::open(const std::string& filename)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	mFile = file;
+	mMapping = mapping;
+	mData = static_cast<const unsigned char*>(view);
+	mSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+	int file = ::open(filename.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		::close(file);
+		return false;
+	}
+
+	void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	if (view == MAP_FAILED)
+	{
+		::close(file);
+		return false;
+	}
+
+	mFile = file;
+	mData = static_cast<const unsigned char*>(view);
+	mSize = static_cast<size_t>(info.st_size);
+#endif
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (mData == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(mData);
+	CloseHandle(mMapping);
+	CloseHandle(mFile);
+	mMapping = nullptr;
+	mFile = nullptr;
+#else
+	munmap(const_cast<unsigned char*>(mData), mSize);
+	::close(mFile);
+	mFile = -1;
+#endif
+
+	mData = nullptr;
+	mSize = 0;
+}
@@ -0,0 +1,45 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*****************************************************************
+ * read-only memory mapping of a whole file
+ *****************************************************************/
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// non-copyable, the mapping is owned
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// map a file, returns false if it cannot be opened or is empty
+	bool open(const std::string& filename);
+	// unmap the file
+	void close();
+
+	const unsigned char* data() const { return mData; }
+	size_t size() const { return mSize; }
+	bool isOpen() const { return mData != nullptr; }
+
+	// size and modification time, used to tell whether a cooked cache is stale
+	static bool getStamp(const std::string& filename, uint64_t& size, int64_t& time);
+
+private:
+	const unsigned char* mData = nullptr;
+	size_t mSize = 0;
+
+#ifdef _WIN32
+	void* mFile = nullptr;
+	void* mMapping = nullptr;
+#else
+	int mFile = -1;
+#endif
+};
+
+#endif
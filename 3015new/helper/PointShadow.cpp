@@ -0,0 +1,63 @@
+#include "PointShadow.h"
+
+namespace {
+	// depth bias along the face axis in world units, on top of the polygon offset
+	const float DEPTH_BIAS = 0.02f;
+
+	// GL cube face order: +x, -x, +y, -y, +z, -z
+	const glm::vec3 FACE_DIRECTIONS[PointShadow::NUM_FACES] =
+	{
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+	};
+
+	const glm::vec3 FACE_UPS[PointShadow::NUM_FACES] =
+	{
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+	};
+}
+
+PointShadow::PointShadow()
+{}
+
+PointShadow::~PointShadow()
+{}
+
+void PointShadow::create(int resolution)
+{
+	// the whole cube is rendered at once, gl_Layer picks the face
+	mDepthTarget.create(GL_TEXTURE_CUBE_MAP, resolution, NUM_FACES);
+
+	// the block outlives resizes
+	if (mShadowBuffer.getHandle() == 0)
+		mShadowBuffer.create(sizeof(PointShadowBlock), POINT_SHADOW_BLOCK_BINDING);
+}
+
+void PointShadow::update(const glm::vec3& lightPosition)
+{
+	if (!isCreated())
+		return;
+
+	PointShadowBlock block = {};
+	glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, mNearPlane, mFarPlane);
+	for (int face = 0; face < NUM_FACES; face++)
+	{
+		block.faceMatrices[face] = projection * getFaceViewMatrix(lightPosition, face);
+		mFaceFrustums[face].extract(block.faceMatrices[face]);
+	}
+	block.light = glm::vec4(lightPosition, mFarPlane);
+	block.params = glm::vec4(mNearPlane, DEPTH_BIAS, 0.0f, 0.0f);
+	mShadowBuffer.update(&block, sizeof(block));
+
+	// a box reaching the far plane on every side of the light
+	mRangeViewMatrix = glm::translate(-lightPosition);
+	mRangeProjectionMatrix = glm::ortho(-mFarPlane, mFarPlane, -mFarPlane, mFarPlane, -mFarPlane, mFarPlane);
+}
+
+glm::mat4 PointShadow::getFaceViewMatrix(const glm::vec3& position, int face)
+{
+	return glm::lookAt(position, position + FACE_DIRECTIONS[face], FACE_UPS[face]);
+}
@@ -0,0 +1,76 @@
+#ifndef POINT_SHADOW_H
+#define POINT_SHADOW_H
+
+#include "utilities.h"
+#include "Frustum.h"
+#include "UniformBuffer.h"
+#include "DepthTarget.h"
+
+// point shadow uniform block (std140), matches PointShadowBlock in the shaders
+struct PointShadowBlock
+{
+	glm::mat4 faceMatrices[6];	// world to clip space of each cube face
+	glm::vec4 light;			// light position, far plane
+	glm::vec4 params;			// near plane, depth bias in world units
+};
+
+static_assert(sizeof(PointShadowBlock) == 416, "PointShadowBlock must match the std140 layout");
+
+/*****************************************************************
+ * omnidirectional shadow map of a point light: a depth cube map
+ * attached as one layered target, so all six faces are rendered
+ * in a single pass with a geometry shader routing each triangle
+ * to the faces it touches
+ *****************************************************************/
+class PointShadow
+{
+public:
+	static const int NUM_FACES = 6;
+
+	PointShadow();
+	~PointShadow();
+
+	// non-copyable, the texture and framebuffer are owned
+	PointShadow(const PointShadow&) = delete;
+	PointShadow& operator=(const PointShadow&) = delete;
+
+	// (re)allocate the cube map with square faces
+	void create(int resolution);
+	bool isCreated() const { return mDepthTarget.isCreated(); }
+
+	// place the cube at the light and upload the shadow block
+	void update(const glm::vec3& lightPosition);
+
+	// render every face at once, depth only
+	void begin() { mDepthTarget.begin(); }
+	// rebind the framebuffer the frame is rendered into, the caller restores its viewport
+	void end(GLuint framebuffer) { mDepthTarget.end(framebuffer); }
+
+	// bind the cube map for sampling with a cube shadow sampler
+	void bind(GLuint unit) const { mDepthTarget.bind(unit); }
+
+	// box around the light out to the far plane, anything outside it casts nothing
+	const glm::mat4& getRangeViewMatrix() const { return mRangeViewMatrix; }
+	const glm::mat4& getRangeProjectionMatrix() const { return mRangeProjectionMatrix; }
+	// view frustum of one face, for sending objects only to the faces they touch
+	const Frustum& getFaceFrustum(int face) const { return mFaceFrustums[face]; }
+	// view of one face in GL cube map order and orientation, for any cube render target
+	static glm::mat4 getFaceViewMatrix(const glm::vec3& position, int face);
+
+	int getResolution() const { return mDepthTarget.getResolution(); }
+	// light range covered by the map, beyond it nothing is shadowed
+	void setFarPlane(float farPlane) { mFarPlane = farPlane; }
+
+private:
+	DepthTarget mDepthTarget;
+
+	float mNearPlane = 0.05f;
+	float mFarPlane = 20.0f;
+
+	glm::mat4 mRangeViewMatrix = glm::mat4(1.0f);
+	glm::mat4 mRangeProjectionMatrix = glm::mat4(1.0f);
+	Frustum mFaceFrustums[NUM_FACES];
+	UniformBuffer mShadowBuffer;
+};
+
+#endif
@@ -0,0 +1,193 @@
+#include "ReflectionProbe.h"
+#include "GLState.h"
+#include "GpuProfiler.h"
+#include "PointShadow.h"
+
+#include <algorithm>
+
+namespace {
+	// the scene is captured with the main camera's depth range
+	const float NEAR_PLANE = 0.1f;
+	const float FAR_PLANE = 100.0f;
+}
+
+ReflectionProbe::ReflectionProbe()
+{}
+
+ReflectionProbe::~ReflectionProbe()
+{
+	release();
+}
+
+void ReflectionProbe::release()
+{
+	mCubeMap.adopt(0, GL_TEXTURE_CUBE_MAP);
+	if (mDepthBuffer != 0)
+		glDeleteRenderbuffers(1, &mDepthBuffer);
+	GLuint framebuffers[] = { mFBO, mPrefilterFBO };
+	for (GLuint framebuffer : framebuffers)
+	{
+		if (framebuffer != 0)
+			glDeleteFramebuffers(1, &framebuffer);
+	}
+	if (mVAO != 0)
+	{
+		GLState::deleteVertexArray(mVAO);
+		glDeleteVertexArrays(1, &mVAO);
+	}
+	mDepthBuffer = 0;
+	mFBO = 0;
+	mPrefilterFBO = 0;
+	mVAO = 0;
+	mCapturedFaces.clear();
+}
+
+void ReflectionProbe::create(int resolution, int levels)
+{
+	release();
+	mResolution = std::max(resolution, 1);
+
+	// the chain stops where a face is too small to hold a useful reflection
+	int fullChain = 1;
+	while ((mResolution >> fullChain) > 0)
+		fullChain++;
+	mLevels = glm::clamp(levels, 1, fullChain);
+
+	GLuint cubeMap = 0;
+	glGenTextures(1, &cubeMap);
+	GLState::bindTexture(0, GL_TEXTURE_CUBE_MAP, cubeMap);
+	glTexStorage2D(GL_TEXTURE_CUBE_MAP, mLevels, GL_RGBA8, mResolution, mResolution);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, mLevels - 1);
+	mCubeMap.adopt(cubeMap, GL_TEXTURE_CUBE_MAP);
+
+	// the small levels are filtered across face edges, so lookups must be too
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+	glGenRenderbuffers(1, &mDepthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, mDepthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mResolution, mResolution);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	// the face is attached when it is captured
+	glGenFramebuffers(1, &mFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X, cubeMap, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mDepthBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cerr << "Reflection probe framebuffer is incomplete" << std::endl;
+
+	glGenFramebuffers(1, &mPrefilterFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glGenVertexArrays(1, &mVAO);
+
+	mProjectionMatrix = glm::perspective(glm::radians(90.0f), 1.0f, NEAR_PLANE, FAR_PLANE);
+	mNextFace = 0;
+	mFacesToCapture = NUM_FACES;
+	mCredit = 0.0;
+	mFaceCost = 0.0;
+	mAverageFaces = 0.0;
+}
+
+int ReflectionProbe::schedule(double measuredMilliseconds)
+{
+	if (!isCreated())
+		return 0;
+
+	// a new cube holds nothing yet, so it is filled in one go whatever it costs
+	if (mFacesToCapture > 0)
+	{
+		int faces = mFacesToCapture;
+		mFacesToCapture = 0;
+		mAverageFaces = faces;
+		return faces;
+	}
+
+	// the profiler averages whole updates, which captured a varying number of faces
+	if (measuredMilliseconds > 0.0 && mAverageFaces > 0.0)
+		mFaceCost = measuredMilliseconds / mAverageFaces;
+
+	// unspent budget carries over for as long as one face needs, so an expensive face is
+	// captured every few frames rather than never, and a cheap one never bursts
+	mCredit = std::min(mCredit + mBudget, std::max(mBudget, mFaceCost));
+
+	int faces = 0;
+	while (faces < MAX_FACES_PER_FRAME && mCredit >= mFaceCost)
+	{
+		mCredit -= mFaceCost;
+		faces++;
+	}
+
+	// frames without an update record no sample, so they are left out here as well
+	if (faces > 0)
+		mAverageFaces += (faces - mAverageFaces) / GpuProfiler::HISTORY_SIZE;
+	return faces;
+}
+
+int ReflectionProbe::beginFace()
+{
+	int face = mNextFace;
+	mNextFace = (mNextFace + 1) % NUM_FACES;
+	mCapturedFaces.push_back(face);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
+		mCubeMap.getHandle(), 0);
+	glViewport(0, 0, mResolution, mResolution);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	return face;
+}
+
+void ReflectionProbe::prefilter(GLSLProgram& prefilter)
+{
+	if (mCapturedFaces.empty())
+		return;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, mPrefilterFBO);
+	glDisable(GL_DEPTH_TEST);
+	GLState::bindVertexArray(mVAO);
+
+	prefilter.use();
+	prefilter.setUniform("uSource", 0);
+	GLState::bindTexture(0, GL_TEXTURE_CUBE_MAP, mCubeMap.getHandle());
+
+	// each level reads only the one above it, so the level being written is never sampled
+	for (int level = 1; level < mLevels; level++)
+	{
+		int size = std::max(mResolution >> level, 1);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, level - 1);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, level - 1);
+		glViewport(0, 0, size, size);
+		prefilter.setUniform("uSourceLevel", static_cast<float>(level - 1));
+		prefilter.setUniform("uSourceTexel", 2.0f / static_cast<float>(std::max(mResolution >> (level - 1), 1)));
+
+		for (int face : mCapturedFaces)
+		{
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
+				mCubeMap.getHandle(), level);
+			prefilter.setUniform("uFace", face);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+		}
+	}
+
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, mLevels - 1);
+	glEnable(GL_DEPTH_TEST);
+	mCapturedFaces.clear();
+}
+
+void ReflectionProbe::end(GLuint framebuffer)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+glm::mat4 ReflectionProbe::getViewMatrix(int face) const
+{
+	return PointShadow::getFaceViewMatrix(mPosition, face);
+}
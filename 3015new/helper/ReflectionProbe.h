@@ -0,0 +1,82 @@
+#ifndef REFLECTION_PROBE_H
+#define REFLECTION_PROBE_H
+
+#include "utilities.h"
+#include "Texture.h"
+
+/*****************************************************************
+ * environment cube map rendered from the scene at run time: a
+ * few faces are captured per frame in round-robin order, as many
+ * as a per-frame GPU time budget allows, and each captured face
+ * is filtered down a short mip chain that rough reflections
+ * sample from
+ *****************************************************************/
+class ReflectionProbe
+{
+public:
+	static const int NUM_FACES = 6;
+	static const int MAX_FACES_PER_FRAME = 2;
+
+	ReflectionProbe();
+	~ReflectionProbe();
+
+	// non-copyable, the framebuffers are owned
+	ReflectionProbe(const ReflectionProbe&) = delete;
+	ReflectionProbe& operator=(const ReflectionProbe&) = delete;
+
+	// (re)allocate the cube map with square faces and at most the given number of mip levels;
+	// every face is captured again on the next frame
+	void create(int resolution, int levels);
+	bool isCreated() const { return mFBO != 0; }
+
+	// faces to capture this frame, measuredMilliseconds being the rolling average of earlier
+	// updates (capture and prefilter); 0 until it is known
+	int schedule(double measuredMilliseconds);
+
+	// render the next face in round-robin order into level 0, returns its index
+	int beginFace();
+	// filter the mip chain of the faces captured since the last call; prefilter is
+	// shader/cubePrefilter.vert and shader/cubePrefilter.frag
+	void prefilter(GLSLProgram& prefilter);
+	// stop capturing and bind framebuffer again, the viewport is still sized for the probe
+	void end(GLuint framebuffer);
+
+	// the cube map, bound like any other texture
+	Texture& getTexture() { return mCubeMap; }
+
+	void setPosition(const glm::vec3& position) { mPosition = position; }
+	glm::mat4 getViewMatrix(int face) const;
+	const glm::mat4& getProjectionMatrix() const { return mProjectionMatrix; }
+
+	int getResolution() const { return mResolution; }
+	int numLevels() const { return mLevels; }
+	// GPU time the probe may use per frame on average, in milliseconds
+	void setBudget(double milliseconds) { mBudget = milliseconds; }
+	double getBudget() const { return mBudget; }
+
+private:
+	Texture mCubeMap;
+	GLuint mDepthBuffer = 0;
+	GLuint mFBO = 0;
+	GLuint mPrefilterFBO = 0;	// colour only, one face of one level at a time
+	GLuint mVAO = 0;			// empty, the prefilter triangle is generated in the shader
+	int mResolution = 0;
+	int mLevels = 0;
+
+	glm::vec3 mPosition = glm::vec3(0.0f);
+	glm::mat4 mProjectionMatrix = glm::mat4(1.0f);
+
+	int mNextFace = 0;
+	int mFacesToCapture = 0;	// faces still missing after create(), captured regardless of the budget
+	std::vector<int> mCapturedFaces;
+
+	// every frame adds the budget to the credit, every face captured spends its measured cost
+	double mBudget = 1.0;
+	double mCredit = 0.0;
+	double mFaceCost = 0.0;
+	double mAverageFaces = 0.0;	// faces per frame over the frames the profiler averages
+
+	void release();
+};
+
+#endif
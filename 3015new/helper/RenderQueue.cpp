@@ -0,0 +1,208 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+	// sort key layout, most significant state first
+	const int PROGRAM_SHIFT = 56;		// 8 bits
+	const int MATERIAL_SHIFT = 44;		// 12 bits
+	const int TEXTURE0_SHIFT = 34;		// 10 bits
+	const int TEXTURE1_SHIFT = 24;		// 10 bits
+	const uint64_t DEPTH_BITS = 24;		// front to back within equal state
+
+	uint64_t textureBits(const Texture* texture)
+	{
+		// texture names only group draws, a collision just costs an extra bind
+		return texture ? (texture->getHandle() & 0x3FF) : 0;
+	}
+}
+
+RenderQueue::RenderQueue()
+{}
+
+int RenderQueue::registerProgram(GLSLProgram& program, bool textured)
+{
+	ProgramEntry entry;
+	entry.program = &program;
+	entry.textured = textured;
+	entry.modelViewProjectionMatrix = program.getUniformHandle("uModelViewProjectionMatrix");
+	entry.modelMatrix = program.getUniformHandle("uModelMatrix");
+	entry.normalMatrix = program.getUniformHandle("uNormalMatrix");
+	entry.layerMask = program.getUniformHandle("uLayerMask");
+
+	mPrograms.push_back(entry);
+	reloadProgram(program);
+	return static_cast<int>(mPrograms.size()) - 1;
+}
+
+void RenderQueue::reloadProgram(GLSLProgram& program)
+{
+	bool registered = false;
+	for (const ProgramEntry& entry : mPrograms)
+		registered |= entry.program == &program;
+	if (!registered)
+		return;
+
+	// sampler units never change, so they are only set when the program is (re)linked
+	program.use();
+	program.setUniform("uTextureSampler", 0);
+	program.setUniform("uNormalSampler", 1);
+	program.setUniform("uEnvironmentMap", 0);
+	program.setUniform("uShadowMap", static_cast<int>(SHADOW_MAP_UNIT));
+	program.setUniform("uPointShadowMap", static_cast<int>(POINT_SHADOW_MAP_UNIT));
+}
+
+int RenderQueue::registerMaterial(UniformBuffer& materialBuffer)
+{
+	mMaterials.push_back(&materialBuffer);
+	return static_cast<int>(mMaterials.size()) - 1;
+}
+
+void RenderQueue::begin(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
+{
+	mItems.clear();
+	mViewMatrix = viewMatrix;
+	mViewProjectionMatrix = projectionMatrix * viewMatrix;
+
+	// far plane of a perspective projection, used to normalise depth
+	float denominator = projectionMatrix[2][2] + 1.0f;
+	mFarPlane = denominator != 0.0f ? projectionMatrix[3][2] / denominator : 100.0f;
+	if (mFarPlane <= 0.0f)
+		mFarPlane = 100.0f;
+}
+
+void RenderQueue::submit(const DrawItem& item)
+{
+	mItems.push_back(item);
+	mItems.back().key = makeKey(mItems.back());
+}
+
+uint64_t RenderQueue::makeKey(const DrawItem& item) const
+{
+	// view distance of the object origin, quantised to DEPTH_BITS
+	float distance = item.depth;
+	if (item.hasModelMatrix)
+		distance = -(mViewMatrix * item.modelMatrix[3]).z;
+
+	float normalised = glm::clamp(distance / mFarPlane, 0.0f, 1.0f);
+	uint64_t depth = static_cast<uint64_t>(normalised * ((1u << DEPTH_BITS) - 1));
+
+	// untextured items sort by depth alone within their program
+	if (!mPrograms[item.program].textured)
+		return (static_cast<uint64_t>(item.program & 0xFF) << PROGRAM_SHIFT) | depth;
+
+	return (static_cast<uint64_t>(item.program & 0xFF) << PROGRAM_SHIFT) |
+		(static_cast<uint64_t>(item.material & 0xFFF) << MATERIAL_SHIFT) |
+		(textureBits(item.textures[0]) << TEXTURE0_SHIFT) |
+		(textureBits(item.textures[1]) << TEXTURE1_SHIFT) |
+		depth;
+}
+
+void RenderQueue::radixSort()
+{
+	size_t count = mItems.size();
+
+	mSortKeys.resize(count);
+	mSortScratch.resize(count);
+	for (size_t i = 0; i < count; i++)
+		mSortKeys[i] = std::make_pair(mItems[i].key, static_cast<uint32_t>(i));
+
+	// least significant digit first, 8 bits per pass
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t histogram[257] = {};
+		for (const auto& entry : mSortKeys)
+			histogram[((entry.first >> shift) & 0xFF) + 1]++;
+
+		// every key shares this digit, the pass would not move anything
+		if (std::find(std::begin(histogram) + 1, std::end(histogram), count) != std::end(histogram))
+			continue;
+
+		for (int digit = 0; digit < 256; digit++)
+			histogram[digit + 1] += histogram[digit];
+
+		for (const auto& entry : mSortKeys)
+			mSortScratch[histogram[(entry.first >> shift) & 0xFF]++] = entry;
+
+		mSortKeys.swap(mSortScratch);
+	}
+}
+
+void RenderQueue::flush(GpuProfiler* profiler)
+{
+	mProgramChanges = 0;
+	mMaterialChanges = 0;
+	mTextureChanges = 0;
+
+	radixSort();
+
+	int currentProgram = -1;
+	int currentMaterial = -1;
+	const Texture* currentTextures[2] = {};
+	const char* currentScope = nullptr;
+
+	for (const auto& entry : mSortKeys)
+	{
+		const DrawItem& item = mItems[entry.second];
+		ProgramEntry& program = mPrograms[item.program];
+
+		// profiler scopes follow the sorted order
+		if (profiler && item.scope != currentScope)
+		{
+			if (currentScope)
+				profiler->endScope();
+			if (item.scope)
+				profiler->beginScope(item.scope);
+			currentScope = item.scope;
+		}
+
+		if (item.program != currentProgram)
+		{
+			program.program->use();
+			currentProgram = item.program;
+			mProgramChanges++;
+		}
+
+		if (item.material != currentMaterial && item.material < static_cast<int>(mMaterials.size()))
+		{
+			mMaterials[item.material]->bind();
+			currentMaterial = item.material;
+			mMaterialChanges++;
+		}
+
+		for (int unit = 0; unit < 2 && program.textured; unit++)
+		{
+			if (item.textures[unit] && item.textures[unit] != currentTextures[unit])
+			{
+				item.textures[unit]->bind(unit);
+				currentTextures[unit] = item.textures[unit];
+				mTextureChanges++;
+			}
+		}
+
+		if (item.hasModelMatrix)
+		{
+			// calculate matrices
+			glm::mat4 MVP = mViewProjectionMatrix * item.modelMatrix;
+			glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(item.modelMatrix)));
+
+			program.program->setUniform(program.modelViewProjectionMatrix, MVP);
+			program.program->setUniform(program.modelMatrix, item.modelMatrix);
+			program.program->setUniform(program.normalMatrix, normalMatrix);
+			program.program->setUniform(program.layerMask, item.layerMask);
+		}
+
+		if (item.model)
+			item.model->drawModel();
+		else if (item.quads)
+			item.quads->draw();
+		else if (item.geometry)
+			item.geometry->drawBatch(item.batch);
+	}
+
+	if (profiler && currentScope)
+		profiler->endScope();
+
+	mItems.clear();
+}
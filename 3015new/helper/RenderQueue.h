@@ -0,0 +1,99 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "utilities.h"
+#include "glslprogram.h"
+#include "Texture.h"
+#include "SimpleModel.h"
+#include "InstancedQuad.h"
+#include "StaticGeometry.h"
+#include "UniformBuffer.h"
+#include "GpuProfiler.h"
+
+// a single draw submitted to the render queue
+struct DrawItem
+{
+	uint64_t key = 0;					// filled in by RenderQueue::submit
+	int program = 0;					// index returned by registerProgram
+	int material = 0;					// index returned by registerMaterial
+	Texture* textures[2] = {};			// texture units 0 and 1
+	SimpleModel* model = nullptr;		// either a model ...
+	InstancedQuad* quads = nullptr;		// ... or a batch of instanced quads ...
+	StaticGeometry* geometry = nullptr;	// ... or a batch of static geometry
+	int batch = 0;						// index returned by StaticGeometry::addBatch
+	bool hasModelMatrix = false;		// instanced quads and static geometry carry their own matrices
+	glm::mat4 modelMatrix = glm::mat4(1.0f);
+	float depth = 0.0f;					// view distance used when there is no model matrix
+	int layerMask = 0x3F;				// cube faces a per-object item touches in a layered pass
+	const char* scope = nullptr;		// GPU profiler scope, optional
+};
+
+/*****************************************************************
+ * collects draw items, radix sorts them by a 64-bit state key
+ * (program, material, textures, depth) and submits them with
+ * the fewest program, material and texture changes
+ *****************************************************************/
+class RenderQueue
+{
+public:
+	RenderQueue();
+
+	// register state once at start-up, the returned index goes into DrawItem;
+	// items drawn with an untextured program, e.g. depth only, never bind their textures
+	int registerProgram(GLSLProgram& program, bool textured = true);
+	// restore per-program state after a program has been relinked, ignored if it is not registered
+	void reloadProgram(GLSLProgram& program);
+	int registerMaterial(UniformBuffer& materialBuffer);
+
+	// start a new frame of submissions
+	void begin(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+	void submit(const DrawItem& item);
+	// sort and draw everything submitted since begin()
+	void flush(GpuProfiler* profiler = nullptr);
+
+	// state changes issued by the last flush
+	int getProgramChanges() const { return mProgramChanges; }
+	int getMaterialChanges() const { return mMaterialChanges; }
+	int getTextureChanges() const { return mTextureChanges; }
+
+	// unit above the per-item textures, left to the shadow maps that stay bound for a frame
+	static const GLuint SHADOW_MAP_UNIT = 2;
+	// unit of the point light's cube shadow map, bound alongside the cascades
+	static const GLuint POINT_SHADOW_MAP_UNIT = 3;
+
+private:
+	// per-object uniforms of a registered program
+	struct ProgramEntry
+	{
+		GLSLProgram* program;
+		bool textured;
+		UniformHandle modelViewProjectionMatrix;
+		UniformHandle modelMatrix;
+		UniformHandle normalMatrix;
+		UniformHandle layerMask;
+	};
+
+	std::vector<ProgramEntry> mPrograms;
+	std::vector<UniformBuffer*> mMaterials;
+	std::vector<DrawItem> mItems;
+
+	// (key, item index) pairs and scratch space for the radix sort
+	std::vector<std::pair<uint64_t, uint32_t>> mSortKeys;
+	std::vector<std::pair<uint64_t, uint32_t>> mSortScratch;
+
+	glm::mat4 mViewMatrix = glm::mat4(1.0f);
+	glm::mat4 mViewProjectionMatrix = glm::mat4(1.0f);
+	float mFarPlane = 100.0f;
+
+	int mProgramChanges = 0;
+	int mMaterialChanges = 0;
+	int mTextureChanges = 0;
+
+	uint64_t makeKey(const DrawItem& item) const;
+	void radixSort();
+};
+
+#endif
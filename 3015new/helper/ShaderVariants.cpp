@@ -0,0 +1,64 @@
+#include "ShaderVariants.h"
+
+ShaderVariants::ShaderVariants()
+	: mLoader([](GLSLProgram& program, const char* fileName) { program.compileShader(fileName); })
+{}
+
+void ShaderVariants::setSources(const std::string& vertexFile, const std::string& fragmentFile,
+	const std::vector<std::string>& featureNames)
+{
+	mVertexFile = vertexFile;
+	mFragmentFile = fragmentFile;
+	mFeatureNames = featureNames;
+	mVariants.clear();
+}
+
+void ShaderVariants::setGeometrySource(const std::string& geometryFile, uint32_t features)
+{
+	mGeometryFile = geometryFile;
+	mGeometryFeatures = features;
+	mVariants.clear();
+}
+
+void ShaderVariants::bindUniformBlock(const char* blockName, GLuint binding)
+{
+	mUniformBlocks.emplace_back(blockName, binding);
+	for (auto& variant : mVariants)
+		variant.second->bindUniformBlock(blockName, binding);
+}
+
+void ShaderVariants::bindStorageBlock(const char* blockName, GLuint binding)
+{
+	mStorageBlocks.emplace_back(blockName, binding);
+	for (auto& variant : mVariants)
+		variant.second->bindStorageBlock(blockName, binding);
+}
+
+GLSLProgram& ShaderVariants::get(uint32_t features)
+{
+	auto it = mVariants.find(features);
+	if (it != mVariants.end())
+		return *it->second;
+
+	// defines go in before the sources so they are injected into both stages
+	std::unique_ptr<GLSLProgram> program(new GLSLProgram);
+	for (size_t i = 0; i < mFeatureNames.size(); i++)
+	{
+		if (features & (1u << i))
+			program->addDefine(mFeatureNames[i].c_str());
+	}
+
+	mLoader(*program, mVertexFile.c_str());
+	mLoader(*program, mFragmentFile.c_str());
+	if (!mGeometryFile.empty() && (features & mGeometryFeatures) == mGeometryFeatures)
+		mLoader(*program, mGeometryFile.c_str());
+	for (const auto& block : mUniformBlocks)
+		program->bindUniformBlock(block.first.c_str(), block.second);
+	for (const auto& block : mStorageBlocks)
+		program->bindStorageBlock(block.first.c_str(), block.second);
+	program->link();
+
+	GLSLProgram& result = *program;
+	mVariants[features] = std::move(program);
+	return result;
+}
@@ -0,0 +1,54 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glslprogram.h"
+
+/*****************************************************************
+ * programs built from one vertex/fragment source pair, one per
+ * feature bitmask; bit i defines featureNames[i] in both stages
+ * so that unused paths are compiled out rather than branched over
+ *****************************************************************/
+class ShaderVariants
+{
+public:
+	// reads a stage into a program, e.g. from an asset archive; compileShader by default
+	typedef std::function<void(GLSLProgram& program, const char* fileName)> SourceLoader;
+
+	ShaderVariants();
+
+	void setSources(const std::string& vertexFile, const std::string& fragmentFile,
+		const std::vector<std::string>& featureNames);
+	// geometry stage for the variants that have every bit of features, e.g. layered rendering
+	void setGeometrySource(const std::string& geometryFile, uint32_t features);
+	void setLoader(const SourceLoader& loader) { mLoader = loader; }
+	// applied to every variant, including ones created later
+	void bindUniformBlock(const char* blockName, GLuint binding);
+	void bindStorageBlock(const char* blockName, GLuint binding);
+
+	// variant for a feature mask, compiled on first request; the link is only waited on when first used
+	GLSLProgram& get(uint32_t features);
+
+	// every variant created so far, by feature mask
+	const std::map<uint32_t, std::unique_ptr<GLSLProgram>>& getVariants() const { return mVariants; }
+
+private:
+	std::string mVertexFile;
+	std::string mFragmentFile;
+	std::string mGeometryFile;
+	uint32_t mGeometryFeatures = 0;
+	std::vector<std::string> mFeatureNames;
+	std::vector<std::pair<std::string, GLuint>> mUniformBlocks;
+	std::vector<std::pair<std::string, GLuint>> mStorageBlocks;
+	SourceLoader mLoader;
+
+	std::map<uint32_t, std::unique_ptr<GLSLProgram>> mVariants;
+};
+
+#endif
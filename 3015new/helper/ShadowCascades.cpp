@@ -0,0 +1,116 @@
+#include "ShadowCascades.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// PCF kernel radius in texels, 3x3 taps each filtered 2x2 by the comparison sampler
+	const int PCF_RADIUS = 1;
+	// constant depth bias in shadow map depth units, on top of the polygon offset
+	const float DEPTH_BIAS = 0.0005f;
+}
+
+ShadowCascades::ShadowCascades()
+{
+	for (int i = 0; i < MAX_SHADOW_CASCADES; i++)
+	{
+		mViewMatrices[i] = glm::mat4(1.0f);
+		mProjectionMatrices[i] = glm::mat4(1.0f);
+	}
+}
+
+ShadowCascades::~ShadowCascades()
+{}
+
+void ShadowCascades::create(int cascades, int resolution)
+{
+	mNumCascades = glm::clamp(cascades, 1, MAX_SHADOW_CASCADES);
+	// one layer per cascade, compared against in the sampler so PCF taps are filtered
+	mDepthTarget.create(GL_TEXTURE_2D_ARRAY, resolution, mNumCascades);
+
+	// the block outlives resizes
+	if (mShadowBuffer.getHandle() == 0)
+		mShadowBuffer.create(sizeof(ShadowBlock), SHADOW_BLOCK_BINDING);
+}
+
+void ShadowCascades::update(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const glm::vec3& lightDir)
+{
+	if (!isCreated())
+		return;
+
+	// near and far planes of a perspective projection, the far plane limited to the shadow distance
+	float nearPlane = projectionMatrix[3][2] / (projectionMatrix[2][2] - 1.0f);
+	float farPlane = std::min(projectionMatrix[3][2] / (projectionMatrix[2][2] + 1.0f), mShadowDistance);
+
+	glm::mat4 inverseView = glm::inverse(viewMatrix);
+	glm::mat4 inverseProjection = glm::inverse(projectionMatrix);
+
+	// view space rays through the frustum corners, scaled to unit depth
+	glm::vec3 rays[4];
+	for (int i = 0; i < 4; i++)
+	{
+		glm::vec4 corner = inverseProjection * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, 1.0f, 1.0f);
+		glm::vec3 ray = glm::vec3(corner) / corner.w;
+		rays[i] = ray / -ray.z;
+	}
+
+	glm::vec3 direction = glm::normalize(lightDir);
+	float resolution = static_cast<float>(mDepthTarget.getResolution());
+	glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+	// maps clip space to texture space
+	const glm::mat4 bias = glm::translate(glm::vec3(0.5f)) * glm::scale(glm::vec3(0.5f));
+
+	ShadowBlock block = {};
+	float sliceNear = nearPlane;
+	for (int cascade = 0; cascade < mNumCascades; cascade++)
+	{
+		// practical split scheme, logarithmic near the camera and uniform further out
+		float fraction = static_cast<float>(cascade + 1) / mNumCascades;
+		float logSplit = nearPlane * std::pow(farPlane / nearPlane, fraction);
+		float uniformSplit = nearPlane + (farPlane - nearPlane) * fraction;
+		float sliceFar = mSplitLambda * logSplit + (1.0f - mSplitLambda) * uniformSplit;
+
+		// world space corners of the slice and their bounding sphere, whose size does not change with rotation
+		glm::vec3 corners[8];
+		glm::vec3 center(0.0f);
+		for (int i = 0; i < 8; i++)
+		{
+			float depth = (i & 4) ? sliceFar : sliceNear;
+			corners[i] = glm::vec3(inverseView * glm::vec4(rays[i & 3] * depth, 1.0f));
+			center += corners[i] / 8.0f;
+		}
+		float radius = 0.0f;
+		for (int i = 0; i < 8; i++)
+			radius = std::max(radius, glm::length(corners[i] - center));
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		// orthographic box around the sphere, pulled back toward the light for casters outside the slice
+		glm::vec3 eye = center - direction * (radius + mCasterDistance);
+		glm::mat4 lightView = glm::lookAt(eye, center, up);
+		glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + mCasterDistance);
+
+		// snap the world origin to a texel so the map only moves in whole texels
+		glm::vec4 origin = lightProjection * lightView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		glm::vec2 texels = glm::vec2(origin) * (resolution * 0.5f);
+		glm::vec2 offset = (glm::round(texels) - texels) * (2.0f / resolution);
+		lightProjection[3][0] += offset.x;
+		lightProjection[3][1] += offset.y;
+
+		mViewMatrices[cascade] = lightView;
+		mProjectionMatrices[cascade] = lightProjection;
+
+		block.matrices[cascade] = bias * lightProjection * lightView;
+		block.splits[cascade] = sliceFar;
+		sliceNear = sliceFar;
+	}
+
+	block.params = glm::ivec4(mNumCascades, PCF_RADIUS, 0, 0);
+	block.texel = glm::vec4(1.0f / resolution, DEPTH_BIAS, 0.0f, 0.0f);
+	mShadowBuffer.update(&block, sizeof(block));
+}
+
+void ShadowCascades::beginCascade(int cascade)
+{
+	mDepthTarget.begin(cascade);
+}
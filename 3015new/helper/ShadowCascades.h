@@ -0,0 +1,78 @@
+#ifndef SHADOW_CASCADES_H
+#define SHADOW_CASCADES_H
+
+#include "utilities.h"
+#include "Frustum.h"
+#include "UniformBuffer.h"
+#include "DepthTarget.h"
+
+// must match MAX_CASCADES in the shaders
+const int MAX_SHADOW_CASCADES = 4;
+
+// shadow uniform block (std140), matches ShadowBlock in the shaders
+struct ShadowBlock
+{
+	glm::mat4 matrices[MAX_SHADOW_CASCADES];	// world to shadow map texture space
+	glm::vec4 splits;		// far view distance of each cascade
+	glm::ivec4 params;		// cascade count, PCF kernel radius in texels
+	glm::vec4 texel;		// texel size, depth bias
+};
+
+static_assert(sizeof(ShadowBlock) == 304, "ShadowBlock must match the std140 layout");
+
+/*****************************************************************
+ * cascaded shadow maps for a directional light: the view
+ * frustum is split by distance and each slice gets its own
+ * orthographic depth map, one layer of a depth texture array,
+ * fitted to the slice's bounding sphere and snapped to texels
+ * so it does not shimmer as the camera moves
+ *****************************************************************/
+class ShadowCascades
+{
+public:
+	ShadowCascades();
+	~ShadowCascades();
+
+	// non-copyable, the texture and framebuffer are owned
+	ShadowCascades(const ShadowCascades&) = delete;
+	ShadowCascades& operator=(const ShadowCascades&) = delete;
+
+	// (re)allocate the maps, cascades is clamped to [1, MAX_SHADOW_CASCADES]
+	void create(int cascades, int resolution);
+	bool isCreated() const { return mDepthTarget.isCreated(); }
+
+	// fit the cascades to a camera and upload the shadow block
+	void update(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const glm::vec3& lightDir);
+
+	// render into one cascade's layer, depth only
+	void beginCascade(int cascade);
+	// rebind the framebuffer the frame is rendered into, the caller restores its viewport
+	void end(GLuint framebuffer) { mDepthTarget.end(framebuffer); }
+
+	// bind the maps for sampling with a shadow sampler
+	void bind(GLuint unit) const { mDepthTarget.bind(unit); }
+
+	int numCascades() const { return mNumCascades; }
+	int getResolution() const { return mDepthTarget.getResolution(); }
+	const glm::mat4& getViewMatrix(int cascade) const { return mViewMatrices[cascade]; }
+	const glm::mat4& getProjectionMatrix(int cascade) const { return mProjectionMatrices[cascade]; }
+
+	// view distance covered by the cascades, the rest of the frustum is unshadowed
+	void setShadowDistance(float distance) { mShadowDistance = distance; }
+	// blend between uniform (0) and logarithmic (1) split distances
+	void setSplitLambda(float lambda) { mSplitLambda = lambda; }
+
+private:
+	DepthTarget mDepthTarget;
+	int mNumCascades = 0;
+
+	float mShadowDistance = 20.0f;
+	float mSplitLambda = 0.75f;
+	float mCasterDistance = 10.0f;		// how far behind a slice casters are still rendered
+
+	glm::mat4 mViewMatrices[MAX_SHADOW_CASCADES];
+	glm::mat4 mProjectionMatrices[MAX_SHADOW_CASCADES];
+	UniformBuffer mShadowBuffer;
+};
+
+#endif
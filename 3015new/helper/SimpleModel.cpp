@@ -1,4 +1,20 @@
 #include "SimpleModel.h"
+#include "MappedFile.h"
+#include "GLState.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace {
+	const char MESH_CACHE_MAGIC[4] = { 'S', 'M', 'C', '\0' };
+	const uint32_t MESH_CACHE_VERSION = 2;
+	const uint64_t MESH_CACHE_ALIGNMENT = 16;
+
+	uint64_t alignOffset(uint64_t offset)
+	{
+		return (offset + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+	}
+}
 
 SimpleModel::SimpleModel()
 {}
@@ -11,12 +27,45 @@ SimpleModel::~SimpleModel()
 	if (mMesh.IBO != 0)
 		glDeleteBuffers(1, &mMesh.IBO);
 	if (mMesh.VAO != 0)
+	{
+		GLState::deleteVertexArray(mMesh.VAO);
 		glDeleteVertexArrays(1, &mMesh.VAO);
+	}
 
 	mIsValid = false;
 }
 
 void SimpleModel::loadModel(const char *filename, bool texture)
+{
+	// cooked cache sits next to the source model
+	mCacheFile = std::string(filename) + ".mesh";
+
+	// use the cooked mesh if it is still up to date
+	if (loadMeshCache(filename, texture))
+		return;
+
+	if (!importModel(filename, texture, true))
+	{
+		// output error message and exit
+		std::cerr << "Failed to open: " << filename << std::endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+bool SimpleModel::cook(const char *filename, bool texture)
+{
+	// nothing is uploaded, so no OpenGL objects are created or deleted
+	SimpleModel model;
+	model.mCacheFile = std::string(filename) + ".mesh";
+
+	MappedFile file;
+	if (model.mapMeshCache(filename, texture, file))
+		return true;
+
+	return model.importModel(filename, texture, false);
+}
+
+bool SimpleModel::importModel(const char* filename, bool texture, bool upload)
 {
 	// Create an instance of the Importer class
 	Assimp::Importer importer;
@@ -29,47 +78,168 @@ void SimpleModel::loadModel(const char *filename, bool texture)
 
 	// check whether scene was loaded
 	if (!scene)
+		return false;
+
+	// every mesh goes into the same vertex and index arrays
+	mSubMeshes.clear();
+	mMesh.hasTexCoords = false;
+
+	if (!texture)
 	{
-		// output error message and exit
-		std::cerr << "Failed to open: " << filename << std::endl;
-		exit(EXIT_FAILURE);
-	}
+		std::vector<VertexNormal> vertices;
+		std::vector<GLuint> indices;
 
-	// only loads first mesh
-	if(!texture)
-		loadMesh(scene->mMeshes[0]);
+		for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+		{
+			size_t firstIndex = indices.size();
+			size_t baseVertex = vertices.size();
+			if (loadMesh(scene->mMeshes[i], vertices, indices))
+				addSubMesh(scene->mMeshes[i], firstIndex, indices.size() - firstIndex, baseVertex);
+		}
+
+		// nothing drawable, the model stays invalid
+		if (mSubMeshes.empty())
+			return true;
+
+		// store cooked data for the next launch
+		writeMeshCache(vertices.data(), sizeof(VertexNormal), static_cast<uint32_t>(vertices.size()), indices, false);
+
+		if (upload)
+			createBuffers(vertices.data(), sizeof(VertexNormal) * vertices.size(),
+				indices.data(), static_cast<GLsizei>(indices.size()), false);
+	}
 	else
-		loadMeshWithTexture(scene->mMeshes[0]);
+	{
+		std::vector<VertexNormTex> vertices;
+		std::vector<GLuint> indices;
+
+		for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+		{
+			size_t firstIndex = indices.size();
+			size_t baseVertex = vertices.size();
+			if (loadMeshWithTexture(scene->mMeshes[i], vertices, indices))
+				addSubMesh(scene->mMeshes[i], firstIndex, indices.size() - firstIndex, baseVertex);
+		}
+
+		// nothing drawable, the model stays invalid
+		if (mSubMeshes.empty())
+			return true;
+
+		// store cooked data for the next launch
+		writeMeshCache(vertices.data(), sizeof(VertexNormTex), static_cast<uint32_t>(vertices.size()), indices, true);
+
+		if (upload)
+			createBuffers(vertices.data(), sizeof(VertexNormTex) * vertices.size(),
+				indices.data(), static_cast<GLsizei>(indices.size()), true);
+	}
 
 	// importer's destructor will clean up
+	return true;
 }
 
 void SimpleModel::drawModel()
 {
 	if (mIsValid)
 	{
-		glBindVertexArray(mMesh.VAO);		// make mesh VAO active
-		glDrawElements(GL_TRIANGLES, mMesh.numOfIndices, GL_UNSIGNED_INT, 0);	// render vertices
+		GLState::bindVertexArray(mMesh.VAO);		// make mesh VAO active
+
+		// all submeshes in one call, indices are local to each submesh
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, mDrawCounts.data(), GL_UNSIGNED_INT,
+			mDrawOffsets.data(), static_cast<GLsizei>(mDrawCounts.size()), mDrawBaseVertices.data());
+	}
+}
+
+void SimpleModel::drawSubMesh(int index)
+{
+	if (mIsValid && index >= 0 && index < static_cast<int>(mSubMeshes.size()))
+	{
+		GLState::bindVertexArray(mMesh.VAO);		// make mesh VAO active
+		glDrawElementsBaseVertex(GL_TRIANGLES, mDrawCounts[index], GL_UNSIGNED_INT,
+			mDrawOffsets[index], mDrawBaseVertices[index]);
 	}
 }
 
-void SimpleModel::loadMesh(const aiMesh *mesh)
+void SimpleModel::copyGeometry(std::vector<VertexNormTanTex>& vertices, std::vector<GLuint>& indices) const
 {
-	// mesh data
-	std::vector<VertexNormal> vertices;
-	std::vector<GLint> indices;
+	vertices.clear();
+	indices.clear();
+	if (!mIsValid)
+		return;
 
-	// check if mesh contains vertex coordinates, normals and faces
-	if (!mesh->HasPositions() || !mesh->HasNormals() || !mesh->HasFaces())
+	// read back rather than keep a client copy of every model
+	std::vector<unsigned char> vertexData(static_cast<size_t>(mMesh.vertexBytes));
+	std::vector<GLuint> indexData(mMesh.numOfIndices);
+	glBindBuffer(GL_COPY_READ_BUFFER, mMesh.VBO);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, mMesh.vertexBytes, vertexData.data());
+	glBindBuffer(GL_COPY_READ_BUFFER, mMesh.IBO);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(GLuint) * indexData.size(), indexData.data());
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	size_t stride = mMesh.texCoordFormat ? sizeof(VertexNormTex) : sizeof(VertexNormal);
+	vertices.resize(vertexData.size() / stride);
+	for (size_t i = 0; i < vertices.size(); i++)
 	{
-		mIsValid = false;
-		return;
+		// position and normal lead both formats
+		VertexNormTanTex& vertex = vertices[i];
+		const VertexNormTex* source = reinterpret_cast<const VertexNormTex*>(vertexData.data() + i * stride);
+		std::memcpy(vertex.position, source->position, sizeof(vertex.position));
+		std::memcpy(vertex.normal, source->normal, sizeof(vertex.normal));
+		std::memset(vertex.tangent, 0, sizeof(vertex.tangent));
+		if (mMesh.texCoordFormat)
+			std::memcpy(vertex.texCoord, source->texCoord, sizeof(vertex.texCoord));
+		else
+			std::memset(vertex.texCoord, 0, sizeof(vertex.texCoord));
 	}
 
+	// one index list, local submesh indices made absolute
+	indices.reserve(indexData.size());
+	for (const SubMesh& subMesh : mSubMeshes)
+	{
+		for (uint32_t i = 0; i < subMesh.numIndices; i++)
+			indices.push_back(indexData[subMesh.firstIndex + i] + subMesh.baseVertex);
+	}
+}
+
+void SimpleModel::addSubMesh(const aiMesh* mesh, size_t firstIndex, size_t numIndices, size_t baseVertex)
+{
+	SubMesh subMesh;
+	subMesh.firstIndex = static_cast<uint32_t>(firstIndex);
+	subMesh.numIndices = static_cast<uint32_t>(numIndices);
+	subMesh.baseVertex = static_cast<int32_t>(baseVertex);
+	subMesh.materialIndex = mesh->mMaterialIndex;
+
+	mSubMeshes.push_back(subMesh);
+}
+
+void SimpleModel::buildDrawArguments()
+{
+	mDrawCounts.resize(mSubMeshes.size());
+	mDrawOffsets.resize(mSubMeshes.size());
+	mDrawBaseVertices.resize(mSubMeshes.size());
+
+	for (size_t i = 0; i < mSubMeshes.size(); i++)
+	{
+		mDrawCounts[i] = static_cast<GLsizei>(mSubMeshes[i].numIndices);
+		mDrawOffsets[i] = reinterpret_cast<const void*>(sizeof(GLuint) * mSubMeshes[i].firstIndex);
+		mDrawBaseVertices[i] = mSubMeshes[i].baseVertex;
+	}
+}
+
+bool SimpleModel::loadMesh(const aiMesh *mesh, std::vector<VertexNormal>& vertices, std::vector<GLuint>& indices)
+{
+	// check if mesh contains vertex coordinates, normals and faces
+	if (!mesh->HasPositions() || !mesh->HasNormals() || !mesh->HasFaces())
+		return false;
+
+	// size the arrays up front, faces are triangles after aiProcess_Triangulate
+	size_t baseVertex = vertices.size();
+	vertices.resize(baseVertex + mesh->mNumVertices);
+	indices.reserve(indices.size() + mesh->mNumFaces * 3);
+
 	// get vertex data
 	for (unsigned int i = 0; i < mesh->mNumVertices; i++)
 	{
-		VertexNormal vertex;	// for vertex data
+		VertexNormal& vertex = vertices[baseVertex + i];	// for vertex data
 
 		// get vertex position
 		vertex.position[0] = mesh->mVertices[i].x;
@@ -80,9 +250,6 @@ void SimpleModel::loadMesh(const aiMesh *mesh)
 		vertex.normal[0] = mesh->mNormals[i].x;
 		vertex.normal[1] = mesh->mNormals[i].y;
 		vertex.normal[2] = mesh->mNormals[i].z;
-
-		// append vertex data
-		vertices.push_back(vertex);
 	}
 
 	// get face data
@@ -95,59 +262,31 @@ void SimpleModel::loadMesh(const aiMesh *mesh)
 		}
 	}
 
-	// store total number of indices
-	mMesh.numOfIndices = static_cast<int>(indices.size());
-
-	// generate identifier for VBOs and copy data to GPU
-	glGenBuffers(1, &mMesh.VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, mMesh.VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(VertexNormal) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
-
-	// generate identifier for IBO and copy data to GPU
-	glGenBuffers(1, &mMesh.IBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mMesh.IBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLint) * indices.size(), &indices[0], GL_STATIC_DRAW);
-
-	// generate identifiers for VAO and supply information
-	glGenVertexArrays(1, &mMesh.VAO);
-	glBindVertexArray(mMesh.VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, mMesh.VBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mMesh.IBO);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormal), reinterpret_cast<void*>(offsetof(VertexNormal, position)));
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormal), reinterpret_cast<void*>(offsetof(VertexNormal, normal)));
-
-	// enable vertex attributes
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-
-	// unbind VAO
-	glBindVertexArray(0);
-
-	mIsValid = true;
+	return true;
 }
 
-void SimpleModel::loadMeshWithTexture(const aiMesh* mesh)
+bool SimpleModel::loadMeshWithTexture(const aiMesh* mesh, std::vector<VertexNormTex>& vertices, std::vector<GLuint>& indices)
 {
-	// mesh data
-	std::vector<VertexNormTex> vertices;
-	std::vector<GLint> indices;
-
 	// check if mesh contains vertex coordinates, normals and faces
 	if (!mesh->HasPositions() || !mesh->HasNormals() || !mesh->HasFaces())
-	{
-		mIsValid = false;
-		return;
-	}
+		return false;
+
 	// check if mesh contains texture coordinates (i.e. index 0)
-	if (mesh->HasTextureCoords(0))
+	bool hasTexCoords = mesh->HasTextureCoords(0);
+	if (hasTexCoords)
 	{
 		mMesh.hasTexCoords = true;
 	}
 
+	// size the arrays up front, faces are triangles after aiProcess_Triangulate
+	size_t baseVertex = vertices.size();
+	vertices.resize(baseVertex + mesh->mNumVertices);
+	indices.reserve(indices.size() + mesh->mNumFaces * 3);
+
 	// get vertex data
 	for (unsigned int i = 0; i < mesh->mNumVertices; i++)
 	{
-		VertexNormTex vertex;	// for vertex data
+		VertexNormTex& vertex = vertices[baseVertex + i];	// for vertex data
 
 		// get vertex position
 		vertex.position[0] = mesh->mVertices[i].x;
@@ -160,7 +299,7 @@ void SimpleModel::loadMeshWithTexture(const aiMesh* mesh)
 		vertex.normal[2] = mesh->mNormals[i].z;
 
 		// get first vertex texture coordinate (i.e. index 0)
-		if (mMesh.hasTexCoords)
+		if (hasTexCoords)
 		{
 			vertex.texCoord[0] = mesh->mTextureCoords[0][i].x;
 			vertex.texCoord[1] = mesh->mTextureCoords[0][i].y;
@@ -169,9 +308,6 @@ void SimpleModel::loadMeshWithTexture(const aiMesh* mesh)
 		{
 			vertex.texCoord[0] = vertex.texCoord[1] = 0.0f;
 		}
-
-		// append vertex data
-		vertices.push_back(vertex);
 	}
 
 	// get face data
@@ -184,35 +320,189 @@ void SimpleModel::loadMeshWithTexture(const aiMesh* mesh)
 		}
 	}
 
+	return true;
+}
+
+bool SimpleModel::mapMeshCache(const char* filename, bool texture, MappedFile& file)
+{
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	// size and modification time identify the source model a cache was cooked from
+	if (!MappedFile::getStamp(filename, sourceSize, sourceTime))
+		return false;
+
+	if (!file.open(mCacheFile) || file.size() < sizeof(MeshCacheHeader))
+		return false;
+
+	MeshCacheHeader header;
+	std::memcpy(&header, file.data(), sizeof(header));
+
+	// reject caches from another version, vertex format or source model
+	if (std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != MESH_CACHE_VERSION ||
+		header.vertexFormat != (texture ? 1u : 0u) ||
+		header.sourceSize != sourceSize || header.sourceTime != sourceTime)
+	{
+		file.close();
+		return false;
+	}
+
+	return true;
+}
+
+bool SimpleModel::loadMeshCache(const char* filename, bool texture)
+{
+	MappedFile file;
+	if (!mapMeshCache(filename, texture, file))
+		return false;
+
+	return loadCooked(file.data(), file.size(), texture);
+}
+
+bool SimpleModel::loadCooked(const unsigned char* data, size_t size, bool texture)
+{
+	if (size < sizeof(MeshCacheHeader))
+		return false;
+
+	MeshCacheHeader header;
+	std::memcpy(&header, data, sizeof(header));
+
+	// the source stamp is not checked, archives are cooked ahead of time
+	if (std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != MESH_CACHE_VERSION ||
+		header.vertexFormat != (texture ? 1u : 0u))
+		return false;
+
+	size_t vertexSize = texture ? sizeof(VertexNormTex) : sizeof(VertexNormal);
+	uint64_t vertexBytes = static_cast<uint64_t>(header.numVertices) * vertexSize;
+	uint64_t indexBytes = static_cast<uint64_t>(header.numIndices) * sizeof(GLuint);
+	uint64_t subMeshBytes = static_cast<uint64_t>(header.numSubMeshes) * sizeof(SubMesh);
+	if (header.vertexOffset + vertexBytes > size || header.indexOffset + indexBytes > size ||
+		header.subMeshOffset + subMeshBytes > size || header.numSubMeshes == 0)
+		return false;
+
+	// a draw must not read past the index buffer, however the file was truncated or corrupted
+	std::vector<SubMesh> subMeshes(header.numSubMeshes);
+	std::memcpy(subMeshes.data(), data + header.subMeshOffset, static_cast<size_t>(subMeshBytes));
+	for (const SubMesh& subMesh : subMeshes)
+	{
+		if (static_cast<uint64_t>(subMesh.firstIndex) + subMesh.numIndices > header.numIndices)
+			return false;
+	}
+
+	mMesh.hasTexCoords = header.hasTexCoords != 0;
+	mSubMeshes = std::move(subMeshes);
+
+	// mapped pages go straight to the driver, no intermediate copies
+	createBuffers(data + header.vertexOffset, static_cast<GLsizeiptr>(vertexBytes),
+		reinterpret_cast<const GLuint*>(data + header.indexOffset),
+		static_cast<GLsizei>(header.numIndices), texture);
+
+	return true;
+}
+
+void SimpleModel::writeMeshCache(const void* vertices, size_t vertexSize, uint32_t numVertices,
+	const std::vector<GLuint>& indices, bool texture)
+{
+	MeshCacheHeader header = {};
+	std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+	header.version = MESH_CACHE_VERSION;
+	header.vertexFormat = texture ? 1 : 0;
+	header.hasTexCoords = mMesh.hasTexCoords ? 1 : 0;
+	header.numVertices = numVertices;
+	header.numIndices = static_cast<uint32_t>(indices.size());
+
+	// cache is keyed to the source model, strip the ".mesh" suffix to find it
+	std::string source = mCacheFile.substr(0, mCacheFile.size() - 5);
+	if (!MappedFile::getStamp(source, header.sourceSize, header.sourceTime))
+		return;
+
+	uint64_t vertexBytes = static_cast<uint64_t>(numVertices) * vertexSize;
+	header.vertexOffset = alignOffset(sizeof(MeshCacheHeader));
+	header.indexOffset = alignOffset(header.vertexOffset + vertexBytes);
+	header.numSubMeshes = static_cast<uint32_t>(mSubMeshes.size());
+	header.subMeshOffset = alignOffset(header.indexOffset + indices.size() * sizeof(GLuint));
+
+	std::ofstream out(mCacheFile, std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		// a read-only media folder just means no cache
+		return;
+	}
+
+	const char padding[MESH_CACHE_ALIGNMENT] = {};
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(padding, header.vertexOffset - sizeof(header));
+	out.write(static_cast<const char*>(vertices), vertexBytes);
+	out.write(padding, header.indexOffset - (header.vertexOffset + vertexBytes));
+	out.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(GLuint));
+	out.write(padding, header.subMeshOffset - (header.indexOffset + indices.size() * sizeof(GLuint)));
+	out.write(reinterpret_cast<const char*>(mSubMeshes.data()), mSubMeshes.size() * sizeof(SubMesh));
+}
+
+void SimpleModel::createBuffers(const void* vertices, GLsizeiptr vertexBytes,
+	const GLuint* indices, GLsizei numIndices, bool texture)
+{
 	// store total number of indices
-	mMesh.numOfIndices = indices.size();
+	mMesh.numOfIndices = numIndices;
+	mMesh.texCoordFormat = texture;
+	mMesh.vertexBytes = vertexBytes;
+
+	// both vertex formats start with the position
+	size_t stride = texture ? sizeof(VertexNormTex) : sizeof(VertexNormal);
+	size_t numVertices = static_cast<size_t>(vertexBytes) / stride;
+	const unsigned char* vertex = static_cast<const unsigned char*>(vertices);
+	for (size_t i = 0; i < numVertices; i++, vertex += stride)
+	{
+		const GLfloat* position = reinterpret_cast<const GLfloat*>(vertex);
+		glm::vec3 point(position[0], position[1], position[2]);
+
+		if (i == 0)
+			mBounds.min = mBounds.max = point;
+		else
+			mBounds.expand(point);
+	}
 
 	// generate identifier for VBOs and copy data to GPU
 	glGenBuffers(1, &mMesh.VBO);
 	glBindBuffer(GL_ARRAY_BUFFER, mMesh.VBO);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(VertexNormTex), &vertices[0], GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertices, GL_STATIC_DRAW);
 
 	// generate identifier for IBO and copy data to GPU
 	glGenBuffers(1, &mMesh.IBO);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mMesh.IBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLint), &indices[0], GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * numIndices, indices, GL_STATIC_DRAW);
 
 	// generate identifiers for VAO and supply information
 	glGenVertexArrays(1, &mMesh.VAO);
-	glBindVertexArray(mMesh.VAO);
+	GLState::bindVertexArray(mMesh.VAO);
 	glBindBuffer(GL_ARRAY_BUFFER, mMesh.VBO);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mMesh.IBO);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormTex), reinterpret_cast<void*>(offsetof(VertexNormTex, position)));
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormTex), reinterpret_cast<void*>(offsetof(VertexNormTex, normal)));
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VertexNormTex), reinterpret_cast<void*>(offsetof(VertexNormTex, texCoord)));
+	if (!texture)
+	{
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormal), reinterpret_cast<void*>(offsetof(VertexNormal, position)));
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormal), reinterpret_cast<void*>(offsetof(VertexNormal, normal)));
 
-	// enable vertex attributes
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glEnableVertexAttribArray(2);
+		// enable vertex attributes
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+	}
+	else
+	{
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormTex), reinterpret_cast<void*>(offsetof(VertexNormTex, position)));
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormTex), reinterpret_cast<void*>(offsetof(VertexNormTex, normal)));
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VertexNormTex), reinterpret_cast<void*>(offsetof(VertexNormTex, texCoord)));
+
+		// enable vertex attributes
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glEnableVertexAttribArray(2);
+	}
 
 	// unbind VAO
-	glBindVertexArray(0);
+	GLState::bindVertexArray(0);
+
+	buildDrawArguments();
 
 	mIsValid = true;
 }
@@ -5,8 +5,12 @@
 #include <assimp/scene.h>           // output data structure
 #include <assimp/postprocess.h>     // post processing flags
 
+#include <cstdint>
+#include <string>
+
 #include "utilities.h"
 #include "glslprogram.h"
+#include "Frustum.h"
 
 struct Mesh
 {
@@ -16,10 +20,42 @@ struct Mesh
     GLuint VAO = 0;
     int numOfIndices = 0;
     bool hasTexCoords = false;
+    bool texCoordFormat = false;    // VertexNormTex rather than VertexNormal
+    GLsizeiptr vertexBytes = 0;
+};
+
+// range of the shared vertex/index buffers that came from one aiMesh
+struct SubMesh
+{
+    uint32_t firstIndex;    // offset into the index buffer, in indices
+    uint32_t numIndices;
+    int32_t baseVertex;     // added to every index of the submesh
+    uint32_t materialIndex; // aiMesh::mMaterialIndex
+};
+
+// header of the cooked mesh cache written next to the model (<model>.mesh)
+struct MeshCacheHeader
+{
+    char magic[4];          // "SMC" followed by a zero byte
+    uint32_t version;
+    uint32_t vertexFormat;  // 0 = VertexNormal, 1 = VertexNormTex
+    uint32_t hasTexCoords;
+    uint32_t numVertices;
+    uint32_t numIndices;
+    uint64_t sourceSize;    // size of the source model when the cache was cooked
+    int64_t sourceTime;     // modification time of the source model
+    uint64_t vertexOffset;  // byte offset of the interleaved vertex blob
+    uint64_t indexOffset;   // byte offset of the GLuint index blob
+    uint32_t numSubMeshes;
+    uint32_t reserved;
+    uint64_t subMeshOffset; // byte offset of the SubMesh table
 };
 
+class MappedFile;
+
 /*****************************************************************
- * simple model class that loads the first mesh of a model
+ * simple model class that loads every mesh of a model into one
+ * vertex and index buffer and draws them with a single call
  *****************************************************************/
 class SimpleModel
 {
@@ -28,14 +64,50 @@ public:
     ~SimpleModel();
 
     void loadModel(const char *filename, bool texture = false);
+    // load from a cooked mesh already in memory, e.g. an archive entry
+    bool loadCooked(const unsigned char* data, size_t size, bool texture = false);
+    // write the <model>.mesh cache without creating any OpenGL objects
+    static bool cook(const char *filename, bool texture = false);
     void drawModel();
+    // draw a single submesh, e.g. after binding its material
+    void drawSubMesh(int index);
+
+    const std::vector<SubMesh>& getSubMeshes() const { return mSubMeshes; }
+
+    // read the uploaded mesh back as one tangent-space vertex list (zero tangents) with submesh
+    // base vertices applied, e.g. to merge it into shared buffers; no-op until loaded
+    void copyGeometry(std::vector<VertexNormTanTex>& vertices, std::vector<GLuint>& indices) const;
+
+    // object space bounds of the mesh, computed when it is loaded
+    const BoundingBox& getBounds() const { return mBounds; }
 
 private:
     bool mIsValid = false;
     Mesh mMesh;
+    BoundingBox mBounds;
+    std::vector<SubMesh> mSubMeshes;
+
+    // glMultiDrawElementsBaseVertex arguments, built once from mSubMeshes
+    std::vector<GLsizei> mDrawCounts;
+    std::vector<const void*> mDrawOffsets;
+    std::vector<GLint> mDrawBaseVertices;
+    std::string mCacheFile;
  
-    void loadMesh(const aiMesh *mesh);
-    void loadMeshWithTexture(const aiMesh* mesh);
+    // append a mesh to the shared vertex and index arrays
+    bool loadMesh(const aiMesh *mesh, std::vector<VertexNormal>& vertices, std::vector<GLuint>& indices);
+    bool loadMeshWithTexture(const aiMesh* mesh, std::vector<VertexNormTex>& vertices, std::vector<GLuint>& indices);
+    void addSubMesh(const aiMesh* mesh, size_t firstIndex, size_t numIndices, size_t baseVertex);
+
+    // import with assimp and write the cache, upload creates the buffers as well
+    bool importModel(const char* filename, bool texture, bool upload);
+    // map the cache if it matches the source model
+    bool mapMeshCache(const char* filename, bool texture, MappedFile& file);
+    bool loadMeshCache(const char* filename, bool texture);
+    void writeMeshCache(const void* vertices, size_t vertexSize, uint32_t numVertices,
+        const std::vector<GLuint>& indices, bool texture);
+    void buildDrawArguments();
+    void createBuffers(const void* vertices, GLsizeiptr vertexBytes,
+        const GLuint* indices, GLsizei numIndices, bool texture);
 };
 
 #endif
@@ -0,0 +1,285 @@
+#include "StaticGeometry.h"
+#include "GLState.h"
+#include "glutils.h"
+
+#include <algorithm>
+
+namespace {
+	// matches local_size_x in shader/cull.comp
+	const GLuint CULL_GROUP_SIZE = 64;
+
+	const char* const FRUSTUM_PLANE_NAMES[Frustum::NUM_PLANES] =
+	{
+		"uFrustumPlanes[0]", "uFrustumPlanes[1]", "uFrustumPlanes[2]",
+		"uFrustumPlanes[3]", "uFrustumPlanes[4]", "uFrustumPlanes[5]"
+	};
+}
+
+StaticGeometry::StaticGeometry()
+{}
+
+StaticGeometry::~StaticGeometry()
+{
+	// delete buffers
+	GLuint buffers[] = { mVBO, mIBO, mCommandBuffer, mDrawDataBuffer, mCullDataBuffer, mVisibleCommandBuffer, mVisibleCountBuffer };
+	for (GLuint buffer : buffers)
+	{
+		if (buffer != 0)
+			glDeleteBuffers(1, &buffer);
+	}
+	if (mVAO != 0)
+	{
+		GLState::deleteVertexArray(mVAO);
+		glDeleteVertexArrays(1, &mVAO);
+	}
+}
+
+int StaticGeometry::addMesh(const std::vector<VertexNormTanTex>& vertices, const std::vector<GLuint>& indices)
+{
+	Mesh mesh;
+	mesh.firstIndex = static_cast<GLuint>(mIndices.size());
+	mesh.numIndices = static_cast<GLuint>(indices.size());
+	mesh.baseVertex = static_cast<GLint>(mVertices.size());
+
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		glm::vec3 position(vertices[i].position[0], vertices[i].position[1], vertices[i].position[2]);
+		if (i == 0)
+			mesh.bounds.min = mesh.bounds.max = position;
+		else
+			mesh.bounds.expand(position);
+	}
+
+	mVertices.insert(mVertices.end(), vertices.begin(), vertices.end());
+	mIndices.insert(mIndices.end(), indices.begin(), indices.end());
+
+	mMeshes.push_back(mesh);
+	return static_cast<int>(mMeshes.size()) - 1;
+}
+
+int StaticGeometry::addModel(const SimpleModel& model)
+{
+	std::vector<VertexNormTanTex> vertices;
+	std::vector<GLuint> indices;
+	model.copyGeometry(vertices, indices);
+
+	return addMesh(vertices, indices);
+}
+
+int StaticGeometry::addQuad()
+{
+	// same corners as the InstancedQuad strip
+	std::vector<VertexNormTanTex> vertices =
+	{
+		{ { -1.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f } },
+		{ { 1.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f } },
+		{ { -1.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f } },
+		{ { 1.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f } },
+	};
+	std::vector<GLuint> indices = { 0, 1, 2, 2, 1, 3 };
+
+	return addMesh(vertices, indices);
+}
+
+int StaticGeometry::addBatch()
+{
+	mBatches.push_back(Batch());
+	return static_cast<int>(mBatches.size()) - 1;
+}
+
+int StaticGeometry::addObject(int batch, int mesh, const glm::mat4& modelMatrix)
+{
+	Object object;
+	object.batch = batch;
+	object.mesh = mesh;
+	object.modelMatrix = modelMatrix;
+
+	mObjects.push_back(object);
+	return static_cast<int>(mObjects.size()) - 1;
+}
+
+void StaticGeometry::create()
+{
+	// commands of a batch must be contiguous, objects were added in any order
+	std::vector<int> order(mObjects.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = static_cast<int>(i);
+	std::stable_sort(order.begin(), order.end(),
+		[this](int a, int b) { return mObjects[a].batch < mObjects[b].batch; });
+
+	std::vector<DrawElementsIndirectCommand> commands(order.size());
+	std::vector<StaticDrawData> drawData(order.size());
+	std::vector<StaticCullData> cullData(order.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const Object& object = mObjects[order[i]];
+		const Mesh& mesh = mMeshes[object.mesh];
+
+		DrawElementsIndirectCommand& command = commands[i];
+		command.count = mesh.numIndices;
+		command.instanceCount = 1;
+		command.firstIndex = mesh.firstIndex;
+		command.baseVertex = mesh.baseVertex;
+		command.baseInstance = static_cast<GLuint>(i);
+
+		// the normal matrix is constant for a static object, so compute it once here
+		drawData[i].modelMatrix = object.modelMatrix;
+		drawData[i].normalMatrix = glm::mat4(glm::mat3(glm::transpose(glm::inverse(object.modelMatrix))));
+
+		Batch& batch = mBatches[object.batch];
+		if (batch.numCommands == 0)
+			batch.firstCommand = static_cast<GLuint>(i);
+		batch.numCommands++;
+
+		BoundingBox bounds = mesh.bounds.transformed(object.modelMatrix);
+		cullData[i].boundsMin = glm::vec4(bounds.min, 0.0f);
+		cullData[i].boundsMax = glm::vec4(bounds.max, 0.0f);
+		cullData[i].batch = static_cast<GLuint>(object.batch);
+		cullData[i].batchFirst = batch.firstCommand;
+		cullData[i].pad[0] = cullData[i].pad[1] = 0;
+	}
+
+	// create VBO and IBO
+	glGenBuffers(1, &mVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(VertexNormTanTex) * mVertices.size(), mVertices.data(), GL_STATIC_DRAW);
+
+	// create command and per-draw buffers
+	glGenBuffers(1, &mCommandBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand) * commands.size(), commands.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	glGenBuffers(1, &mDrawDataBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mDrawDataBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(StaticDrawData) * drawData.size(), drawData.data(), GL_STATIC_DRAW);
+
+	// cull pass input and output, the output is only ever written by the GPU
+	if (isCullingSupported())
+	{
+		glGenBuffers(1, &mCullDataBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mCullDataBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(StaticCullData) * cullData.size(), cullData.data(), GL_STATIC_DRAW);
+
+		glGenBuffers(1, &mVisibleCommandBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mVisibleCommandBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawElementsIndirectCommand) * commands.size(), nullptr, GL_DYNAMIC_COPY);
+
+		glGenBuffers(1, &mVisibleCountBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mVisibleCountBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * mBatches.size(), nullptr, GL_DYNAMIC_COPY);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// create VAO, specify VBO data and format of the data
+	glGenVertexArrays(1, &mVAO);
+	GLState::bindVertexArray(mVAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormTanTex),
+		reinterpret_cast<void*>(offsetof(VertexNormTanTex, position)));		// specify format of position data
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormTanTex),
+		reinterpret_cast<void*>(offsetof(VertexNormTanTex, normal)));		// specify format of normal data
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormTanTex),
+		reinterpret_cast<void*>(offsetof(VertexNormTanTex, tangent)));		// specify format of tangent data
+	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(VertexNormTanTex),
+		reinterpret_cast<void*>(offsetof(VertexNormTanTex, texCoord)));		// specify format of texture coordinate data
+
+	glEnableVertexAttribArray(0);	// enable vertex attributes
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glEnableVertexAttribArray(3);
+
+	// the element buffer binding is VAO state
+	glGenBuffers(1, &mIBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * mIndices.size(), mIndices.data(), GL_STATIC_DRAW);
+
+	// unbind VAO
+	GLState::bindVertexArray(0);
+
+	// the GPU copies are all that is drawn from now on
+	std::vector<VertexNormTanTex>().swap(mVertices);
+	std::vector<GLuint>().swap(mIndices);
+}
+
+void StaticGeometry::drawBatch(int batch)
+{
+	const Batch& range = mBatches[batch];
+	if (mVAO == 0 || range.numCommands == 0)
+		return;
+
+	GLState::bindVertexArray(mVAO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, mDrawDataBuffer);
+
+	const void* offset = reinterpret_cast<void*>(sizeof(DrawElementsIndirectCommand) * range.firstCommand);
+	if (mCulling && mVisibleCountBuffer != 0)
+	{
+		// the batch's count was written by the cull pass, the CPU never reads it
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mVisibleCommandBuffer);
+		glBindBuffer(GL_PARAMETER_BUFFER, mVisibleCountBuffer);
+		glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, offset,
+			static_cast<GLintptr>(sizeof(GLuint) * batch), static_cast<GLsizei>(range.numCommands), 0);
+	}
+	else
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, offset, static_cast<GLsizei>(range.numCommands), 0);
+	}
+}
+
+void StaticGeometry::cull(GLSLProgram& program, const Frustum& frustum, const DepthPyramid* occluders)
+{
+	if (mVisibleCountBuffer == 0 || mObjects.empty())
+		return;
+
+	// every batch starts empty
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mVisibleCountBuffer);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_DATA_BINDING, mCullDataBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, mCommandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBLE_COMMAND_BINDING, mVisibleCommandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBLE_COUNT_BINDING, mVisibleCountBuffer);
+
+	program.use();
+	program.setUniform("uNumObjects", static_cast<int>(mObjects.size()));
+	for (int i = 0; i < Frustum::NUM_PLANES; i++)
+		program.setUniform(FRUSTUM_PLANE_NAMES[i], frustum.getPlane(i));
+
+	bool occlusion = occluders && occluders->isValid();
+	program.setUniform("uOcclusion", occlusion);
+	if (occlusion)
+	{
+		occluders->bind(0);
+		program.setUniform("uDepthPyramid", 0);
+		program.setUniform("uPyramidViewProjection", occluders->getViewProjectionMatrix());
+		program.setUniform("uPyramidSize", occluders->getSize());
+	}
+
+	glDispatchCompute((static_cast<GLuint>(mObjects.size()) + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	// the draws read the commands and counts as indirect parameters
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+}
+
+bool StaticGeometry::isSupported()
+{
+#ifdef __APPLE__
+	// macOS stops at OpenGL 4.1
+	return false;
+#else
+	// gl_BaseInstanceARB is core GLSL from 4.6 as gl_BaseInstance, the extension form is used either way
+	return GLAD_GL_VERSION_4_3 && GLUtils::hasExtension("GL_ARB_shader_draw_parameters");
+#endif
+}
+
+bool StaticGeometry::isCullingSupported()
+{
+#ifdef __APPLE__
+	return false;
+#else
+	return isSupported() && GLAD_GL_VERSION_4_6 && DepthPyramid::isSupported();
+#endif
+}
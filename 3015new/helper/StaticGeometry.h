@@ -0,0 +1,133 @@
+#ifndef STATIC_GEOMETRY_H
+#define STATIC_GEOMETRY_H
+
+#include <vector>
+
+#include "utilities.h"
+#include "Frustum.h"
+#include "SimpleModel.h"
+#include "DepthPyramid.h"
+#include "UniformBuffer.h"
+
+// glMultiDrawElementsIndirect command layout
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;		// index of the draw's StaticDrawData
+};
+
+// per-draw data block (std430), read by the vertex shader
+struct StaticDrawData
+{
+	glm::mat4 modelMatrix;
+	glm::mat4 normalMatrix;		// mat3 padded to four columns
+};
+
+// per-object data block (std430), read by the cull pass
+struct StaticCullData
+{
+	glm::vec4 boundsMin;		// world space box, w unused
+	glm::vec4 boundsMax;
+	GLuint batch;
+	GLuint batchFirst;			// first command of the batch
+	GLuint pad[2];
+};
+
+/*****************************************************************
+ * meshes merged into one vertex and index buffer, with objects
+ * that never move drawn as one glMultiDrawElementsIndirect per
+ * batch; each command's base instance indexes the per-draw data,
+ * so the CPU cost of a batch does not grow with its size;
+ * optionally a compute pass culls the commands on the GPU and
+ * the draws take their counts from its output
+ *****************************************************************/
+class StaticGeometry
+{
+public:
+	StaticGeometry();
+	~StaticGeometry();
+
+	// non-copyable, the buffer objects are owned
+	StaticGeometry(const StaticGeometry&) = delete;
+	StaticGeometry& operator=(const StaticGeometry&) = delete;
+
+	// add shared geometry and return its mesh index
+	int addMesh(const std::vector<VertexNormTanTex>& vertices, const std::vector<GLuint>& indices);
+	int addModel(const SimpleModel& model);
+	// the [-1, 1] quad of InstancedQuad as two triangles
+	int addQuad();
+
+	// batches group objects drawn with the same program and textures
+	int addBatch();
+	// place a mesh in a batch, returns the object index
+	int addObject(int batch, int mesh, const glm::mat4& modelMatrix);
+
+	// upload everything added so far; nothing can be added afterwards
+	void create();
+	bool isCreated() const { return mVAO != 0; }
+
+	// draw every object of a batch with one call
+	void drawBatch(int batch);
+
+	// test every object against the frustum and the occluders of an earlier frame, if valid, with
+	// shader/cull.comp, writing the commands that pass compacted per batch
+	void cull(GLSLProgram& program, const Frustum& frustum, const DepthPyramid* occluders);
+	// draw the commands written by the last cull() rather than all of them
+	void setCulling(bool enabled) { mCulling = enabled; }
+	bool isCulling() const { return mCulling; }
+
+	int numObjects() const { return static_cast<int>(mObjects.size()); }
+	int numBatches() const { return static_cast<int>(mBatches.size()); }
+
+	// requires multi-draw indirect, storage buffers and the draw parameters in GLSL
+	static bool isSupported();
+	// culling also requires glMultiDrawElementsIndirectCount
+	static bool isCullingSupported();
+
+private:
+	struct Mesh
+	{
+		GLuint firstIndex = 0;
+		GLuint numIndices = 0;
+		GLint baseVertex = 0;
+		BoundingBox bounds;
+	};
+
+	struct Object
+	{
+		int batch = 0;
+		int mesh = 0;
+		glm::mat4 modelMatrix = glm::mat4(1.0f);
+	};
+
+	// range of the command buffer
+	struct Batch
+	{
+		GLuint firstCommand = 0;
+		GLuint numCommands = 0;
+	};
+
+	// OpenGL buffer objects
+	GLuint mVBO = 0;
+	GLuint mIBO = 0;
+	GLuint mVAO = 0;
+	GLuint mCommandBuffer = 0;
+	GLuint mDrawDataBuffer = 0;
+	GLuint mCullDataBuffer = 0;
+	GLuint mVisibleCommandBuffer = 0;
+	GLuint mVisibleCountBuffer = 0;
+	bool mCulling = false;
+
+	// client copies, released by create()
+	std::vector<VertexNormTanTex> mVertices;
+	std::vector<GLuint> mIndices;
+
+	std::vector<Mesh> mMeshes;
+	std::vector<Object> mObjects;
+	std::vector<Batch> mBatches;
+};
+
+#endif
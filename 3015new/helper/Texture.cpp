@@ -1,9 +1,16 @@
 #include "Texture.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <future>
 
 #define STB_IMAGE_IMPLEMENTATION   
 #include "stb/stb_image.h"
 
 Texture::Texture()
+{}
+
+void Texture::initImageLoading()
 {
 	stbi_set_flip_vertically_on_load(true); // flip image about y-axis
 }
@@ -14,6 +21,7 @@ Texture::~Texture()
 	if (mTextureID != 0)
 	{
 		// delete texture
+		GLState::deleteTexture(mTextureID);
 		glDeleteTextures(1, &mTextureID);
 		mTextureID = 0;
 	}
@@ -24,7 +32,16 @@ void Texture::bind()
 	// if texture exists
 	if (mTextureID != 0)
 	{
-		glBindTexture(mTarget, mTextureID);
+		GLState::bindTexture(mTarget, mTextureID);
+	}
+}
+
+void Texture::bind(GLuint unit)
+{
+	// if texture exists
+	if (mTextureID != 0)
+	{
+		GLState::bindTexture(unit, mTarget, mTextureID);
 	}
 }
 
@@ -37,7 +54,7 @@ void Texture::setFilterParams(GLuint magFilter, GLuint minFilter)
 	// change filters if texture exists
 	if (mTextureID != 0)
 	{
-		glBindTexture(GL_TEXTURE_2D, mTextureID);
+		GLState::bindTexture(GL_TEXTURE_2D, mTextureID);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mMagFilter);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mMinFilter);
 	}
@@ -52,7 +69,30 @@ void Texture::setWrapParams(GLuint wrapS, GLuint wrapT)
 	// change wrap mode if texture exists
 	if (mTextureID != 0)
 	{
-		glBindTexture(GL_TEXTURE_2D, mTextureID);
+		GLState::bindTexture(GL_TEXTURE_2D, mTextureID);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, mWrapS);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, mWrapT);
+	}
+}
+
+void Texture::adopt(GLuint textureID, GLenum target)
+{
+	// delete the current texture
+	if (mTextureID != 0)
+	{
+		GLState::deleteTexture(mTextureID);
+		glDeleteTextures(1, &mTextureID);
+	}
+
+	mTextureID = textureID;
+	mTarget = target;
+
+	// apply this texture's parameters to the adopted object
+	if (mTextureID != 0 && mTarget == GL_TEXTURE_2D)
+	{
+		GLState::bindTexture(GL_TEXTURE_2D, mTextureID);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mMagFilter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mMinFilter);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, mWrapS);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, mWrapT);
 	}
@@ -63,7 +103,7 @@ void Texture::generate(unsigned char* imageData, int width, int height)
 {
 	// generate texture
 	glGenTextures(1, &mTextureID);
-	glBindTexture(GL_TEXTURE_2D, mTextureID);
+	GLState::bindTexture(GL_TEXTURE_2D, mTextureID);
 
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, imageData);
 	glGenerateMipmap(GL_TEXTURE_2D);
@@ -90,7 +130,7 @@ void Texture::generate(const std::string filename)
 	{
 		// generate texture
 		glGenTextures(1, &mTextureID);
-		glBindTexture(GL_TEXTURE_2D, mTextureID);
+		GLState::bindTexture(GL_TEXTURE_2D, mTextureID);
 
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, imageData);
 		glGenerateMipmap(GL_TEXTURE_2D);
@@ -117,29 +157,25 @@ void Texture::generate(const std::string fileFront, const std::string fileBack,
 	const std::string fileLeft, const std::string fileRight,
 	const std::string fileTop, const std::string fileBottom)
 {
-	// load image data
-	// assume images are the same size
-	int width, height, channels;
-	unsigned char* imageFront = stbi_load(fileFront.c_str(), &width, &height, &channels, 0);
-	unsigned char* imageBack = stbi_load(fileBack.c_str(), &width, &height, &channels, 0);
-	unsigned char* imageLeft = stbi_load(fileLeft.c_str(), &width, &height, &channels, 0);
-	unsigned char* imageRight = stbi_load(fileRight.c_str(), &width, &height, &channels, 0);
-	unsigned char* imageTop = stbi_load(fileTop.c_str(), &width, &height, &channels, 0);
-	unsigned char* imageBottom = stbi_load(fileBottom.c_str(), &width, &height, &channels, 0);
+	// load image data in face order +X, -X, +Y, -Y, +Z, -Z
+	std::vector<std::string> files = { fileRight, fileLeft, fileTop, fileBottom, fileBack, fileFront };
+	std::vector<unsigned char*> images;
+	int width, height;
 
 	// if successfully loaded cubemap images
-	if (imageFront && imageBack && imageLeft && imageRight && imageTop && imageBottom)
+	if (loadImages(files, images, width, height))
 	{
-		// generate texture
+		// generate texture with immutable storage, then fill each face
 		glGenTextures(1, &mTextureID);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, mTextureID);
+		GLState::bindTexture(GL_TEXTURE_CUBE_MAP, mTextureID);
 
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, imageRight);
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_X, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, imageLeft);
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Y, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, imageTop);
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, imageBottom);
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Z, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, imageBack);
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, imageFront);
+		allocateStorage(GL_TEXTURE_CUBE_MAP, 1, width, height, 0);
+		for (size_t i = 0; i < images.size(); i++)
+		{
+			glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + static_cast<GLenum>(i), 0, 0, 0, width, height,
+				GL_RGB, GL_UNSIGNED_BYTE, images[i]);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
 		// set texture parameters
 		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -148,14 +184,6 @@ void Texture::generate(const std::string fileFront, const std::string fileBack,
 		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-		// free image data
-		stbi_image_free(imageFront);
-		stbi_image_free(imageBack);
-		stbi_image_free(imageLeft);
-		stbi_image_free(imageRight);
-		stbi_image_free(imageTop);
-		stbi_image_free(imageBottom);
-
 		// set texture target
 		mTarget = GL_TEXTURE_CUBE_MAP;
 	}
@@ -163,4 +191,131 @@ void Texture::generate(const std::string fileFront, const std::string fileBack,
 	{
 		std::cout << "Unable to load cubemap images starting with: " << fileFront << std::endl;
 	}
+
+	// free image data
+	freeImages(images);
+}
+
+void Texture::generateArray(const std::vector<std::string>& files)
+{
+	std::vector<unsigned char*> images;
+	int width, height;
+
+	// if successfully loaded every layer
+	if (loadImages(files, images, width, height))
+	{
+		// full mip chain so the array can be trilinearly filtered
+		GLsizei levels = 1;
+		while ((std::max(width, height) >> levels) > 0)
+			levels++;
+
+		// generate texture with immutable storage, then fill each layer
+		glGenTextures(1, &mTextureID);
+		GLState::bindTexture(GL_TEXTURE_2D_ARRAY, mTextureID);
+
+		allocateStorage(GL_TEXTURE_2D_ARRAY, levels, width, height, static_cast<GLsizei>(images.size()));
+		for (size_t i = 0; i < images.size(); i++)
+		{
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(i), width, height, 1,
+				GL_RGB, GL_UNSIGNED_BYTE, images[i]);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+		// set texture parameters
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, mMagFilter);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, mMinFilter);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, mWrapS);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, mWrapT);
+
+		// set texture target
+		mTarget = GL_TEXTURE_2D_ARRAY;
+	}
+	else
+	{
+		std::cout << "Unable to load texture array starting with: " << (files.empty() ? "" : files[0]) << std::endl;
+	}
+
+	// free image data
+	freeImages(images);
+}
+
+bool Texture::loadImages(const std::vector<std::string>& files, std::vector<unsigned char*>& images,
+	int& width, int& height)
+{
+	std::vector<int> widths(files.size()), heights(files.size());
+	images.assign(files.size(), nullptr);
+
+	// decode every file on its own thread, stbi_load is reentrant
+	std::vector<std::future<unsigned char*>> decodes;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		decodes.push_back(std::async(std::launch::async, [&files, &widths, &heights, i]() {
+			int channels;
+			return stbi_load(files[i].c_str(), &widths[i], &heights[i], &channels, 3);
+		}));
+	}
+	for (size_t i = 0; i < files.size(); i++)
+		images[i] = decodes[i].get();
+
+	// every layer must exist and share one size
+	if (files.empty())
+		return false;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (!images[i] || widths[i] != widths[0] || heights[i] != heights[0])
+			return false;
+	}
+
+	width = widths[0];
+	height = heights[0];
+	return true;
+}
+
+void Texture::freeImages(std::vector<unsigned char*>& images)
+{
+	for (unsigned char* image : images)
+	{
+		if (image)
+			stbi_image_free(image);
+	}
+	images.clear();
+}
+
+void Texture::allocateStorage(GLenum target, GLsizei levels, int width, int height, GLsizei layers)
+{
+	// decoded rows are tightly packed RGB, callers restore the default after uploading
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+#ifdef __APPLE__
+	// no immutable storage on 4.1, allocate each level and face with empty images
+	for (GLsizei level = 0; level < levels; level++)
+	{
+		int levelWidth = std::max(1, width >> level);
+		int levelHeight = std::max(1, height >> level);
+
+		if (target == GL_TEXTURE_CUBE_MAP)
+		{
+			for (GLenum face = 0; face < 6; face++)
+			{
+				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB8, levelWidth, levelHeight, 0,
+					GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+			}
+		}
+		else if (target == GL_TEXTURE_2D_ARRAY)
+		{
+			glTexImage3D(target, level, GL_RGB8, levelWidth, levelHeight, layers, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+		}
+		else
+		{
+			glTexImage2D(target, level, GL_RGB8, levelWidth, levelHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+		}
+	}
+	glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+#else
+	if (target == GL_TEXTURE_2D_ARRAY)
+		glTexStorage3D(target, levels, GL_RGB8, width, height, layers);
+	else
+		glTexStorage2D(target, levels, GL_RGB8, width, height);
+#endif
 }
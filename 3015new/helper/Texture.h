@@ -11,6 +11,10 @@ public:
 
 	// binds the texture for use
 	void bind();
+	// binds the texture to the given texture unit
+	void bind(GLuint unit);
+	// OpenGL texture name, 0 until generated
+	GLuint getHandle() const { return mTextureID; }
 	// set texture parameters
 	void setFilterParams(GLuint magFilter, GLuint minFilter);
 	void setWrapParams(GLuint wrapS, GLuint wrapT);
@@ -18,10 +22,18 @@ public:
 	void generate(unsigned char* imageData, int width, int height);	
 	// generate a 2D texture from an image file
 	void generate(const std::string filename);
+	// replace the texture object with an existing one, e.g. a placeholder with streamed data
+	void adopt(GLuint textureID, GLenum target);
 	// generate a cube environment map from image files
 	void generate(const std::string fileFront, const std::string fileBack,
 		const std::string fileLeft, const std::string fileRight,
 		const std::string fileTop, const std::string fileBottom);
+	// generate a 2D texture array with one layer per image file, all the same size
+	void generateArray(const std::vector<std::string>& files);
+
+	// decode every image bottom row first, as GL expects; stb keeps this in one process-wide
+	// flag, so it is set once before any thread decodes
+	static void initImageLoading();
 
 private:
 	// texture ID and parameters
@@ -31,6 +43,13 @@ private:
 	GLuint mMinFilter = GL_LINEAR_MIPMAP_LINEAR;
 	GLuint mWrapS = GL_REPEAT;
 	GLuint mWrapT = GL_REPEAT;
+
+	// decode image files concurrently as RGB, fails unless all load with one size
+	static bool loadImages(const std::vector<std::string>& files, std::vector<unsigned char*>& images,
+		int& width, int& height);
+	static void freeImages(std::vector<unsigned char*>& images);
+	// allocate storage for a bound cube map, 2D texture or 2D texture array
+	static void allocateStorage(GLenum target, GLsizei levels, int width, int height, GLsizei layers);
 };
 
 #endif
@@ -0,0 +1,362 @@
+#include "TextureStreamer.h"
+#include "GLState.h"
+
+#include "stb/stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+TextureStreamer::TextureStreamer()
+{}
+
+TextureStreamer::~TextureStreamer()
+{
+	// stop the decode threads
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mCondition.notify_all();
+	for (std::thread& thread : mThreads)
+		thread.join();
+
+	// free jobs that never finished
+	std::vector<Job*> jobs(mDecodeQueue.begin(), mDecodeQueue.end());
+	jobs.insert(jobs.end(), mDecoded.begin(), mDecoded.end());
+	if (mCurrent)
+		jobs.push_back(mCurrent);
+	for (Job* job : jobs)
+	{
+		if (job->pixels)
+			stbi_image_free(job->pixels);
+		if (job->textureID != 0)
+			glDeleteTextures(1, &job->textureID);
+		delete job;
+	}
+
+	// delete upload ring
+	for (Segment& segment : mSegments)
+	{
+		if (segment.fence)
+			glDeleteSync(segment.fence);
+	}
+	if (mPBO != 0)
+	{
+#ifndef __APPLE__
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPBO);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+#endif
+		glDeleteBuffers(1, &mPBO);
+	}
+}
+
+void TextureStreamer::init(int numThreads)
+{
+	// leave a core for the GL thread
+	if (numThreads <= 0)
+		numThreads = std::max(1, std::min(4, static_cast<int>(std::thread::hardware_concurrency()) - 1));
+
+	for (int i = 0; i < numThreads; i++)
+		mThreads.emplace_back(&TextureStreamer::workerLoop, this);
+
+	// one buffer holds every segment of the ring
+	glGenBuffers(1, &mPBO);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPBO);
+#ifdef __APPLE__
+	// no buffer storage on 4.1, segments are mapped one at a time instead
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, SEGMENT_SIZE * NUM_SEGMENTS, nullptr, GL_STREAM_DRAW);
+#else
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, SEGMENT_SIZE * NUM_SEGMENTS, nullptr, flags);
+	mMapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, SEGMENT_SIZE * NUM_SEGMENTS, flags));
+#endif
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureStreamer::request(Texture& texture, const std::string& filename, TextureCompression compression)
+{
+	// mid grey until the real image is resident
+	unsigned char placeholder[3] = { 128, 128, 128 };
+	texture.generate(placeholder, 1, 1);
+
+	Job* job = new Job;
+	job->texture = &texture;
+	job->filename = filename;
+	job->compression = CompressedImage::isSupported(compression) ? compression : COMPRESSION_NONE;
+	queue(job);
+}
+
+void TextureStreamer::requestCooked(Texture& texture, const std::string& name, const unsigned char* data, size_t size,
+	TextureCompression compression)
+{
+	unsigned char placeholder[3] = { 128, 128, 128 };
+	texture.generate(placeholder, 1, 1);
+
+	// without driver support the loose source image is decoded uncompressed instead
+	Job* job = new Job;
+	job->texture = &texture;
+	job->filename = name;
+	if (CompressedImage::isSupported(compression))
+	{
+		job->compression = compression;
+		job->cookedData = data;
+		job->cookedSize = size;
+	}
+	queue(job);
+}
+
+void TextureStreamer::queue(Job* job)
+{
+	mNumPending++;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mDecodeQueue.push_back(job);
+	}
+	mCondition.notify_one();
+}
+
+void TextureStreamer::workerLoop()
+{
+	for (;;)
+	{
+		Job* job = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this] { return mStopping || !mDecodeQueue.empty(); });
+			if (mStopping)
+				return;
+
+			job = mDecodeQueue.front();
+			mDecodeQueue.pop_front();
+		}
+
+		if (job->cookedData)
+		{
+			// already encoded, only the level table is read
+			job->image.reset(new CompressedImage);
+			if (!job->image->loadCooked(job->cookedData, job->cookedSize, job->compression))
+				job->image.reset();
+		}
+		else if (job->compression != COMPRESSION_NONE)
+		{
+			// encoding is the expensive part, keep it off the GL thread
+			job->image.reset(new CompressedImage);
+			if (!job->image->load(job->filename, job->compression))
+				job->image.reset();
+		}
+		else
+		{
+			// always decode to RGB, which is what gets uploaded
+			int channels;
+			job->pixels = stbi_load(job->filename.c_str(), &job->width, &job->height, &channels, 3);
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mDecoded.push_back(job);
+	}
+}
+
+void TextureStreamer::update(double budgetMs)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	auto elapsed = [&start]() {
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+
+	// rows of odd widths are not 4-byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	while (mNumPending > 0 && elapsed() < budgetMs)
+	{
+		if (!mCurrent)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				if (mDecoded.empty())
+					break;
+				mCurrent = mDecoded.front();
+				mDecoded.pop_front();
+			}
+
+			if (!mCurrent->pixels && !mCurrent->image)
+			{
+				// the placeholder stays, as a failed synchronous load would leave nothing
+				std::cout << "Unable to load: " << mCurrent->filename << std::endl;
+				delete mCurrent;
+				mCurrent = nullptr;
+				mNumPending--;
+				continue;
+			}
+
+			// rows arrive in chunks
+			allocate(*mCurrent);
+		}
+
+		if (mCurrent->level >= 0)
+		{
+			// ring is full, the GPU has not consumed the oldest segment yet
+			if (!uploadChunk(*mCurrent))
+				break;
+		}
+		else
+		{
+			complete(*mCurrent);
+			delete mCurrent;
+			mCurrent = nullptr;
+		}
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void TextureStreamer::allocate(Job& job)
+{
+	glGenTextures(1, &job.textureID);
+	GLState::bindTexture(GL_TEXTURE_2D, job.textureID);
+
+	if (!job.image)
+	{
+		// level 0 only, the rest are generated once it is complete
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, job.width, job.height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+		return;
+	}
+
+	// every level of the encoded chain
+	const CompressedImage& image = *job.image;
+	job.width = image.getLevel(0).width;
+	job.height = image.getLevel(0).height;
+#ifdef __APPLE__
+	for (int level = 0; level < image.numLevels(); level++)
+	{
+		const CompressedLevel& entry = image.getLevel(level);
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, image.getFormat(), entry.width, entry.height, 0,
+			static_cast<GLsizei>(entry.size), nullptr);
+	}
+#else
+	glTexStorage2D(GL_TEXTURE_2D, image.numLevels(), image.getFormat(), job.width, job.height);
+#endif
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.numLevels() - 1);
+}
+
+bool TextureStreamer::uploadChunk(Job& job)
+{
+	Segment& segment = mSegments[mNextSegment];
+	if (segment.fence)
+	{
+		// poll only, never stall the frame
+		GLenum status = glClientWaitSync(segment.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (status == GL_TIMEOUT_EXPIRED)
+			return false;
+
+		glDeleteSync(segment.fence);
+		segment.fence = 0;
+	}
+
+	// compressed levels are uploaded in rows of 4x4 blocks
+	int levelWidth = job.width;
+	int levelHeight = job.height;
+	size_t rowBytes = static_cast<size_t>(job.width) * 3;
+	int totalRows = job.height;
+	const unsigned char* levelData = job.pixels;
+	if (job.image)
+	{
+		const CompressedLevel& entry = job.image->getLevel(job.level);
+		levelWidth = entry.width;
+		levelHeight = entry.height;
+		rowBytes = static_cast<size_t>((levelWidth + 3) / 4) * CompressedImage::getBlockBytes(job.compression);
+		totalRows = (levelHeight + 3) / 4;
+		levelData = job.image->getData(job.level);
+	}
+
+	int rows = std::min(totalRows - job.nextRow, static_cast<int>(SEGMENT_SIZE / rowBytes));
+	const unsigned char* source = levelData + rowBytes * job.nextRow;
+	GLintptr offset = SEGMENT_SIZE * mNextSegment;
+	size_t bytes = rowBytes * rows;
+
+	GLState::bindTexture(GL_TEXTURE_2D, job.textureID);
+
+	if (rows == 0)
+	{
+		// a single row does not fit a segment, upload the rest from client memory
+		rows = totalRows - job.nextRow;
+		bytes = rowBytes * rows;
+		uploadRows(job, levelWidth, levelHeight, rows, bytes, source);
+	}
+	else
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPBO);
+#ifdef __APPLE__
+		void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, bytes,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		std::memcpy(mapped, source, bytes);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+#else
+		std::memcpy(mMapped + offset, source, bytes);
+#endif
+
+		// source pointer is an offset into the bound unpack buffer
+		uploadRows(job, levelWidth, levelHeight, rows, bytes, reinterpret_cast<const void*>(offset));
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		segment.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		mNextSegment = (mNextSegment + 1) % NUM_SEGMENTS;
+	}
+
+	// move on to the next level, -1 once everything is uploaded
+	job.nextRow += rows;
+	if (job.nextRow == totalRows)
+	{
+		job.nextRow = 0;
+		job.level = (job.image && job.level + 1 < job.image->numLevels()) ? job.level + 1 : -1;
+	}
+	return true;
+}
+
+void TextureStreamer::uploadRows(const Job& job, int levelWidth, int levelHeight, int rows, size_t bytes, const void* source)
+{
+	if (job.image)
+	{
+		// sub-image height is a multiple of 4 except where it meets the edge of the level
+		int y = job.nextRow * 4;
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, job.level, 0, y, levelWidth, std::min(rows * 4, levelHeight - y),
+			job.image->getFormat(), static_cast<GLsizei>(bytes), source);
+	}
+	else
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, job.nextRow, levelWidth, rows, GL_RGB, GL_UNSIGNED_BYTE, source);
+	}
+}
+
+void TextureStreamer::complete(Job& job)
+{
+	// every row has been copied out, the decoded image is no longer needed
+	if (job.pixels)
+	{
+		stbi_image_free(job.pixels);
+		job.pixels = nullptr;
+
+		GLState::bindTexture(GL_TEXTURE_2D, job.textureID);
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+
+	// compressed images carry their own mip chain
+	job.image.reset();
+
+	// the placeholder is deleted and the texture takes over the streamed one
+	job.texture->adopt(job.textureID, GL_TEXTURE_2D);
+	job.textureID = 0;
+	mNumPending--;
+}
+
+void TextureStreamer::finish()
+{
+	while (mNumPending > 0)
+	{
+		update(1000.0);
+		std::this_thread::yield();
+	}
+}
@@ -0,0 +1,104 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Texture.h"
+#include "CompressedImage.h"
+
+/*****************************************************************
+ * loads 2D textures in the background: worker threads decode the
+ * image files, the GL thread copies rows into a ring of mapped
+ * pixel buffer segments and uploads them within a per-frame time
+ * budget; each texture shows a placeholder until it is resident;
+ * compressed requests are encoded (or read from their cache) on
+ * the workers and uploaded level by level
+ *****************************************************************/
+class TextureStreamer
+{
+public:
+	TextureStreamer();
+	~TextureStreamer();
+
+	// non-copyable, owns threads and GL buffers
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// start the decode threads and create the upload ring, needs a current context
+	void init(int numThreads = 0);
+
+	// queue a file; the texture gets a placeholder straight away and must outlive the load
+	void request(Texture& texture, const std::string& filename, TextureCompression compression = COMPRESSION_NONE);
+	// queue a cooked mip chain already in memory, e.g. an archive entry, which must outlive the load
+	void requestCooked(Texture& texture, const std::string& name, const unsigned char* data, size_t size,
+		TextureCompression compression);
+
+	// upload decoded images on the GL thread for at most budgetMs milliseconds
+	void update(double budgetMs);
+	// block until every requested texture is resident
+	void finish();
+
+	// textures requested but not yet resident
+	int numPending() const { return mNumPending; }
+
+	static const GLsizeiptr SEGMENT_SIZE = 1 << 20;		// bytes per upload segment
+	static const int NUM_SEGMENTS = 4;					// segments in the upload ring
+
+private:
+	struct Job
+	{
+		Texture* texture = nullptr;
+		std::string filename;
+		TextureCompression compression = COMPRESSION_NONE;
+		const unsigned char* cookedData = nullptr;	// cooked source, instead of the file
+		size_t cookedSize = 0;
+		unsigned char* pixels = nullptr;	// decoded RGB rows, freed once uploaded
+		std::unique_ptr<CompressedImage> image;	// or the encoded mip chain
+		int width = 0;
+		int height = 0;
+		int level = 0;						// mip level being uploaded
+		int nextRow = 0;					// first row (block row if compressed) not yet uploaded
+		GLuint textureID = 0;				// real texture, swapped in when complete
+	};
+
+	struct Segment
+	{
+		GLsync fence = 0;					// signalled when the GPU has read the segment
+	};
+
+	// decode threads
+	std::vector<std::thread> mThreads;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	std::deque<Job*> mDecodeQueue;
+	std::deque<Job*> mDecoded;
+	bool mStopping = false;
+
+	// GL thread state
+	Job* mCurrent = nullptr;
+	int mNumPending = 0;
+	GLuint mPBO = 0;
+	unsigned char* mMapped = nullptr;		// persistent mapping of the whole ring
+	Segment mSegments[NUM_SEGMENTS];
+	int mNextSegment = 0;
+
+	void workerLoop();
+	// hand a job to the decode threads
+	void queue(Job* job);
+	// create the real texture object with storage for every level
+	void allocate(Job& job);
+	// upload as many rows of the current job as fit in one segment, false if the ring is busy
+	bool uploadChunk(Job& job);
+	void uploadRows(const Job& job, int levelWidth, int levelHeight, int rows, size_t bytes, const void* source);
+	void complete(Job& job);
+};
+
+#endif
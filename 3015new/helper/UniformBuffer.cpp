@@ -0,0 +1,41 @@
+#include "UniformBuffer.h"
+
+UniformBuffer::UniformBuffer()
+{}
+
+UniformBuffer::~UniformBuffer()
+{
+	// delete buffer
+	if (mUBO != 0)
+		glDeleteBuffers(1, &mUBO);
+}
+
+void UniformBuffer::create(GLsizeiptr size, GLuint binding)
+{
+	mSize = size;
+	mBinding = binding;
+
+	// allocate storage, contents are supplied by update()
+	glGenBuffers(1, &mUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, mUBO);
+	glBufferData(GL_UNIFORM_BUFFER, mSize, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	bind();
+}
+
+void UniformBuffer::update(const void* data, GLsizeiptr size, GLintptr offset)
+{
+	if (mUBO == 0 || offset + size > mSize)
+		return;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, mUBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::bind()
+{
+	if (mUBO != 0)
+		glBindBufferBase(GL_UNIFORM_BUFFER, mBinding, mUBO);
+}
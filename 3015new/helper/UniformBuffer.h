@@ -0,0 +1,57 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+
+// fixed binding points shared by every shader program
+enum UniformBlockBinding
+{
+	FRAME_BLOCK_BINDING = 0,	// per-frame camera and light data
+	MATERIAL_BLOCK_BINDING = 1,	// per-material data
+	CLUSTER_BLOCK_BINDING = 2,	// light cluster grid parameters
+	SHADOW_BLOCK_BINDING = 3,	// shadow cascade matrices and splits
+	POINT_SHADOW_BLOCK_BINDING = 4	// point light cube face matrices
+};
+
+// fixed shader storage binding points
+enum StorageBlockBinding
+{
+	DRAW_DATA_BINDING = 0,		// per-draw matrices of static geometry
+	CULL_DATA_BINDING = 1,		// per-object bounds read by the cull pass
+	COMMAND_BINDING = 2,		// every command, read by the cull pass
+	VISIBLE_COMMAND_BINDING = 3,	// commands that passed, written by the cull pass
+	VISIBLE_COUNT_BINDING = 4,	// commands that passed per batch
+	LIGHT_BINDING = 5,			// every light of the clustered path
+	CLUSTER_COUNT_BINDING = 6,	// lights per cluster, written by the cluster pass
+	CLUSTER_INDEX_BINDING = 7	// light indices per cluster, written by the cluster pass
+};
+
+/*****************************************************************
+ * uniform buffer object attached to a fixed binding point
+ *****************************************************************/
+class UniformBuffer
+{
+public:
+	UniformBuffer();
+	~UniformBuffer();
+
+	// non-copyable, the buffer object is owned
+	UniformBuffer(const UniformBuffer&) = delete;
+	UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+	// allocate storage and attach to a binding point
+	void create(GLsizeiptr size, GLuint binding);
+	// replace buffer contents
+	void update(const void* data, GLsizeiptr size, GLintptr offset = 0);
+	// attach buffer to its binding point
+	void bind();
+
+	GLuint getHandle() const { return mUBO; }
+
+private:
+	GLuint mUBO = 0;
+	GLuint mBinding = 0;
+	GLsizeiptr mSize = 0;
+};
+
+#endif
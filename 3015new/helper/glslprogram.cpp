@@ -1,8 +1,15 @@
 #include "glslprogram.h"
 
 #include "glutils.h"
+#include "GLState.h"
+#include "MappedFile.h"
 
+#include <GLFW/glfw3.h>
+
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <iostream>
 
 using std::ifstream;
 using std::ios;
@@ -30,16 +37,50 @@ namespace GLSLShaderInfo {
 		{"_frag.glsl", GLSLShader::FRAGMENT},
 		{".frag.glsl", GLSLShader::FRAGMENT},
 		{".cs",   GLSLShader::COMPUTE},
+		{".comp", GLSLShader::COMPUTE},
 		{ ".cs.glsl",   GLSLShader::COMPUTE }
 	};
 }
 
+// GL_KHR_parallel_shader_compile, which the generated loader does not include
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace {
+	const char PROGRAM_BINARY_MAGIC[4] = { 'G', 'L', 'P', 'B' };
+	const uint32_t PROGRAM_BINARY_VERSION = 1;
+
+	// 64-bit FNV-1a, chained across every part of the key
+	uint64_t hashBytes(const void *data, size_t size, uint64_t h = 14695981039346656037ull) {
+		const unsigned char *bytes = static_cast<const unsigned char *>(data);
+		for (size_t i = 0; i < size; ++i) {
+			h = (h ^ bytes[i]) * 1099511628211ull;
+		}
+		return h;
+	}
+
+	// length prefixed, so "ab" + "c" and "a" + "bc" hash differently
+	uint64_t hashString(const char *str, size_t length, uint64_t h) {
+		h = hashBytes(&length, sizeof(length), h);
+		return hashBytes(str, length, h);
+	}
+
+	uint64_t hashGLString(GLenum name, uint64_t h) {
+		const char *str = reinterpret_cast<const char *>(glGetString(name));
+		return hashString(str, str ? strlen(str) : 0, h);
+	}
+}
+
+bool GLSLProgram::parallelCompileSupported = false;
+
 GLSLProgram::GLSLProgram() : handle(0), linked(false) {}
 
 GLSLProgram::~GLSLProgram() {
     if (handle == 0) return;
 	detachAndDeleteShaderObjects();
     // Delete the program
+    GLState::deleteProgram(handle);
     glDeleteProgram(handle);
 }
 
@@ -56,20 +97,19 @@ void GLSLProgram::detachAndDeleteShaderObjects() {
 }
 
 void GLSLProgram::compileShader(const char *fileName) {
+    // Pass the discovered shader type along
+    compileShader(fileName, getShaderType(fileName));
+}
 
+GLSLShader::GLSLShaderType GLSLProgram::getShaderType(const char *fileName) {
     // Check the file name's extension to determine the shader type
     string ext = getExtension(fileName);
-    GLSLShader::GLSLShaderType type = GLSLShader::VERTEX;
 	auto it = GLSLShaderInfo::extensions.find(ext);
-	if (it != GLSLShaderInfo::extensions.end()) {
-		type = it->second;
-	} else {
+	if (it == GLSLShaderInfo::extensions.end()) {
 		string msg = "Unrecognized extension: " + ext;
 		throw GLSLProgramException(msg);
 	}
-
-    // Pass the discovered shader type along
-    compileShader(fileName, type);
+	return it->second;
 }
 
 string GLSLProgram::getExtension(const char *name) {
@@ -125,6 +165,16 @@ void GLSLProgram::compileShader(const char *fileName,
 void GLSLProgram::compileShader(const string &source,
                                 GLSLShader::GLSLShaderType type,
                                 const char *fileName) {
+    compileShaderFromMemory(source.c_str(), source.size(), type, fileName);
+}
+
+void GLSLProgram::compileShaderFromMemory(const char *source, size_t length, const char *fileName) {
+    compileShaderFromMemory(source, length, getShaderType(fileName), fileName);
+}
+
+void GLSLProgram::compileShaderFromMemory(const char *source, size_t length,
+                                          GLSLShader::GLSLShaderType type,
+                                          const char *fileName) {
     if (handle <= 0) {
         handle = glCreateProgram();
         if (handle == 0) {
@@ -132,74 +182,305 @@ void GLSLProgram::compileShader(const string &source,
         }
     }
 
-    GLuint shaderHandle = glCreateShader(type);
+    // copied, the source need not be null terminated or outlive the call
+    PendingStage stage;
+    stage.type = type;
+    stage.source.assign(source, length);
+    if (!defines.empty()) {
+        // #version must stay first; #line keeps error messages pointing at the file's own lines
+        size_t insertAt = 0;
+        if (stage.source.compare(0, 8, "#version") == 0) {
+            insertAt = stage.source.find('\n');
+            if (insertAt == string::npos) {
+                stage.source += '\n';
+                insertAt = stage.source.size() - 1;
+            }
+            ++insertAt;
+        }
+        stage.source.insert(insertAt, defines + (insertAt > 0 ? "#line 2\n" : "#line 1\n"));
+    }
+    if (fileName) {
+        stage.fileName = fileName;
+        sourceFiles.emplace_back(fileName, type);
+    }
+    pendingStages.push_back(std::move(stage));
+}
+
+void GLSLProgram::addDefine(const char *name) {
+    defines += string("#define ") + name + "\n";
+}
+
+bool GLSLProgram::usesFile(const string &fileName) const {
+    for (const auto &file : sourceFiles) {
+        if (file.first == fileName) return true;
+    }
+    return false;
+}
 
-    const char *c_code = source.c_str();
-    glShaderSource(shaderHandle, 1, &c_code, NULL);
+void GLSLProgram::reload() {
+    // a newer edit supersedes a reload still compiling
+    reloading.reset(new GLSLProgram);
+    reloading->defines = defines;
+    try {
+        for (const auto &binding : attribBindings)
+            reloading->bindAttribLocation(binding.second, binding.first.c_str());
+        for (const auto &binding : fragDataBindings)
+            reloading->bindFragDataLocation(binding.second, binding.first.c_str());
+        for (const auto &file : sourceFiles)
+            reloading->compileShader(file.first.c_str(), file.second);
+        reloading->uniformBlockBindings = uniformBlockBindings;
+        reloading->storageBlockBindings = storageBlockBindings;
+        reloading->link();
+    } catch (GLSLProgramException &e) {
+        std::cerr << e.what() << std::endl;
+        reloading.reset();
+    }
+}
+
+bool GLSLProgram::updateReload() {
+    if (!reloading) return false;
+
+    // without parallel compile the wait happens here, once, rather than every frame
+    if (parallelCompileSupported && !reloading->isReady()) return false;
+
+    std::unique_ptr<GLSLProgram> next = std::move(reloading);
+    try {
+        next->finishLink();
+    } catch (GLSLProgramException &e) {
+        // keep running the old program until the source is fixed
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+
+    // take over the new handle, the replacement deletes the old one
+    std::swap(handle, next->handle);
+    linked = true;
+    findUniformLocations();
+    applyUniformBlockBindings();
+    return true;
+}
 
-    // Compile the shader
-    glCompileShader(shaderHandle);
+void GLSLProgram::compilePendingStages() {
+    // submit every stage without waiting, the driver may compile them on its own threads
+    for (PendingStage &stage : pendingStages) {
+        stage.shader = glCreateShader(stage.type);
+
+        // explicit length, the source need not be null terminated
+        const char *source = stage.source.c_str();
+        GLint sourceLength = static_cast<GLint>(stage.source.size());
+        glShaderSource(stage.shader, 1, &source, &sourceLength);
+        glCompileShader(stage.shader);
+        glAttachShader(handle, stage.shader);
+    }
+}
+
+string GLSLProgram::getCompileErrors() {
+    for (const PendingStage &stage : pendingStages) {
+        int result;
+        glGetShaderiv(stage.shader, GL_COMPILE_STATUS, &result);
+        if (GL_TRUE == result) continue;
 
-    // Check for errors
-    int result;
-    glGetShaderiv(shaderHandle, GL_COMPILE_STATUS, &result);
-    if (GL_FALSE == result) {
         // Compile failed, get log
 		std::string msg;
-		if (fileName) {
-			msg = string(fileName) + ": shader compliation failed\n";
+		if (!stage.fileName.empty()) {
+			msg = stage.fileName + ": shader compliation failed\n";
 		}
 		else {
 			msg = "Shader compilation failed.\n";
 		}
 
         int length = 0;
-        glGetShaderiv(shaderHandle, GL_INFO_LOG_LENGTH, &length);
+        glGetShaderiv(stage.shader, GL_INFO_LOG_LENGTH, &length);
         if (length > 0) {
             std::string log(length, ' ');
             int written = 0;
-            glGetShaderInfoLog(shaderHandle, length, &written, &log[0]);
+            glGetShaderInfoLog(stage.shader, length, &written, &log[0]);
 			msg += log;
         }
-        throw GLSLProgramException(msg);
-    } else {
-        // Compile succeeded, attach shader
-        glAttachShader(handle, shaderHandle);
+        return msg;
+    }
+    return string();
+}
+
+uint64_t GLSLProgram::getBinaryKey() {
+    // a binary is only valid for the driver that produced it
+    uint64_t key = hashGLString(GL_VENDOR, hashBytes(nullptr, 0));
+    key = hashGLString(GL_RENDERER, key);
+    key = hashGLString(GL_VERSION, key);
+    for (const auto &binding : attribBindings) {
+        key = hashString(binding.first.data(), binding.first.size(), key);
+        key = hashBytes(&binding.second, sizeof(binding.second), key);
+    }
+    for (const auto &binding : fragDataBindings) {
+        key = hashString(binding.first.data(), binding.first.size(), key);
+        key = hashBytes(&binding.second, sizeof(binding.second), key);
     }
+
+    for (const PendingStage &stage : pendingStages) {
+        key = hashBytes(&stage.type, sizeof(stage.type), key);
+        key = hashString(stage.source.data(), stage.source.size(), key);
+    }
+    return key;
+}
+
+string GLSLProgram::getBinaryFile(uint64_t key) {
+    // next to the first stage's source, like the other cooked caches
+    const string &fileName = pendingStages.front().fileName;
+    size_t slash = fileName.find_last_of("/\\");
+    string dir = slash == string::npos ? string() : fileName.substr(0, slash + 1);
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.program", static_cast<unsigned long long>(key));
+    return dir + name;
+}
+
+bool GLSLProgram::loadBinary(const string &binaryFile, uint64_t key) {
+    MappedFile file;
+    if (!file.open(binaryFile) || file.size() < sizeof(ProgramBinaryHeader))
+        return false;
+
+    ProgramBinaryHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, PROGRAM_BINARY_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != PROGRAM_BINARY_VERSION || header.key != key ||
+        sizeof(header) + static_cast<uint64_t>(header.binarySize) > file.size())
+        return false;
+
+    // the driver may still reject it, e.g. after an update that kept the version string
+    glProgramBinary(handle, header.binaryFormat, file.data() + sizeof(header), header.binarySize);
+    GLint status = GL_FALSE;
+    glGetProgramiv(handle, GL_LINK_STATUS, &status);
+    return status == GL_TRUE;
+}
+
+void GLSLProgram::saveBinary(const string &binaryFile, uint64_t key) {
+    GLint length = 0;
+    glGetProgramiv(handle, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    ProgramBinaryHeader header = {};
+    memcpy(header.magic, PROGRAM_BINARY_MAGIC, sizeof(header.magic));
+    header.version = PROGRAM_BINARY_VERSION;
+    header.key = key;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(handle, length, &written, &format, binary.data());
+    header.binaryFormat = format;
+    header.binarySize = static_cast<uint32_t>(written);
+
+    // a failed write only costs a compile next run
+    std::ofstream out(binaryFile, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(binary.data(), written);
 }
 
 void GLSLProgram::link() {
-    if (linked) return;
-    if (handle <= 0) throw GLSLProgramException("Program has not been compiled.");
+    if (linked || linkPending) return;
+    if (handle <= 0 || pendingStages.empty()) throw GLSLProgramException("Program has not been compiled.");
+
+    initParallelCompile();
+
+    // drivers without binary formats (or stages without a file to sit next to) always compile
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    binaryFile.clear();
+    if (numFormats > 0 && !pendingStages.front().fileName.empty()) {
+        binaryKey = getBinaryKey();
+        binaryFile = getBinaryFile(binaryKey);
+        if (loadBinary(binaryFile, binaryKey)) {
+            // the binary is linked already, nothing to save or compile
+            binaryFile.clear();
+            pendingStages.clear();
+            linkPending = true;
+            finishLink();
+            return;
+        }
+    }
 
+    // mismatch or no cache, build from source; status is checked on first use
+    compilePendingStages();
+    if (!binaryFile.empty())
+        glProgramParameteri(handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(handle);
+    linkPending = true;
+}
+
+bool GLSLProgram::isReady() {
+    if (!linkPending) return linked;
+    if (!parallelCompileSupported) return false;
+
+    // non-blocking, unlike GL_LINK_STATUS
+    GLint complete = GL_FALSE;
+    glGetProgramiv(handle, GL_COMPLETION_STATUS_KHR, &complete);
+    return GL_TRUE == complete;
+}
+
+void GLSLProgram::finishLink() {
+    if (!linkPending) return;
+    linkPending = false;
+
+    // blocks until the driver is done with this program
 	int status = 0;
-	std::string errString;
 	glGetProgramiv(handle, GL_LINK_STATUS, &status);
+
+	std::string errString;
 	if (GL_FALSE == status) {
-		// Store log and return false
-		int length = 0;
-		glGetProgramiv(handle, GL_INFO_LOG_LENGTH, &length);
-		errString += "Program link failed:\n";
-		if (length > 0) {
-			std::string log(length,' ');
-			int written = 0;
-			glGetProgramInfoLog(handle, length, &written, &log[0]);
-			errString += log;
+		// compile errors are more useful than the link error they cause
+		errString = getCompileErrors();
+		if (errString.empty()) {
+			int length = 0;
+			glGetProgramiv(handle, GL_INFO_LOG_LENGTH, &length);
+			errString += "Program link failed:\n";
+			if (length > 0) {
+				std::string log(length,' ');
+				int written = 0;
+				glGetProgramInfoLog(handle, length, &written, &log[0]);
+				errString += log;
+			}
 		}
 	}
-	else {
-		findUniformLocations();
-		linked = true;
+	else if (!binaryFile.empty()) {
+		saveBinary(binaryFile, binaryKey);
 	}
 	 
 	detachAndDeleteShaderObjects();
+	pendingStages.clear();
+	binaryFile.clear();
 
 	if( GL_FALSE == status ) throw GLSLProgramException(errString);
+
+	// throws on a uniform name hash collision, after the stages are released like any link error
+	findUniformLocations();
+	applyUniformBlockBindings();
+	linked = true;
+}
+
+void GLSLProgram::initParallelCompile() {
+    static bool initialized = false;
+    if (initialized) return;
+    initialized = true;
+
+    // not in the generated loader, so look for the extension by hand
+    parallelCompileSupported = GLUtils::hasExtension("GL_KHR_parallel_shader_compile") ||
+                               GLUtils::hasExtension("GL_ARB_parallel_shader_compile");
+
+    // let the driver pick as many threads as it likes
+    typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+    MaxShaderCompilerThreadsProc maxShaderCompilerThreads = nullptr;
+    if (parallelCompileSupported) {
+        maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+        if (!maxShaderCompilerThreads)
+            maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress("glMaxShaderCompilerThreadsARB"));
+    }
+    if (maxShaderCompilerThreads)
+        maxShaderCompilerThreads(0xFFFFFFFFu);
 }
 
 void GLSLProgram::findUniformLocations() {
     uniformLocations.clear();
+    hashedLocations.clear();
 
     GLint numUniforms = 0;
 #ifdef __APPLE__
@@ -238,12 +519,46 @@ void GLSLProgram::findUniformLocations() {
       delete [] name;
     }
 #endif
+
+    for (const auto &uniform : uniformLocations) {
+        auto inserted = hashedLocations.insert({ UniformName::fnv1a(uniform.first.c_str()), { uniform.first, uniform.second } });
+        if (!inserted.second)
+            throw GLSLProgramException("Uniforms " + inserted.first->second.name + " and " + uniform.first +
+                                       " share a name hash, rename one of them");
+    }
+
+    resolveUniformHandles();
+}
+
+void GLSLProgram::resolveUniformHandles() {
+    handleLocations.resize(handleNames.size());
+    for (size_t i = 0; i < handleNames.size(); ++i) {
+        handleLocations[i] = getUniformLocation(handleNames[i].c_str());
+    }
+}
+
+UniformHandle GLSLProgram::getUniformHandle(const char *name) {
+    UniformHandle uniform;
+
+    // reuse the slot if the name has been resolved before
+    for (size_t i = 0; i < handleNames.size(); ++i) {
+        if (handleNames[i] == name) {
+            uniform.slot = static_cast<int>(i);
+            return uniform;
+        }
+    }
+
+    uniform.slot = static_cast<int>(handleNames.size());
+    handleNames.push_back(name);
+    handleLocations.push_back(linked ? getUniformLocation(name) : -1);
+    return uniform;
 }
 
 void GLSLProgram::use() {
+    finishLink();
     if (handle <= 0 || (!linked))
         throw GLSLProgramException("Shader has not been linked");
-    glUseProgram(handle);
+    GLState::useProgram(handle);
 }
 
 int GLSLProgram::getHandle() {
@@ -251,15 +566,48 @@ int GLSLProgram::getHandle() {
 }
 
 bool GLSLProgram::isLinked() {
+    finishLink();
     return linked;
 }
 
 void GLSLProgram::bindAttribLocation(GLuint location, const char *name) {
     glBindAttribLocation(handle, location, name);
+    attribBindings.emplace_back(name, location);
 }
 
 void GLSLProgram::bindFragDataLocation(GLuint location, const char *name) {
     glBindFragDataLocation(handle, location, name);
+    fragDataBindings.emplace_back(name, location);
+}
+
+void GLSLProgram::bindUniformBlock(const char *blockName, GLuint binding) {
+    // remembered so the binding survives relinking
+    uniformBlockBindings[blockName] = binding;
+    if (linked) applyUniformBlockBindings();
+}
+
+void GLSLProgram::bindStorageBlock(const char *blockName, GLuint binding) {
+    // remembered so the binding survives relinking
+    storageBlockBindings[blockName] = binding;
+    if (linked) applyUniformBlockBindings();
+}
+
+void GLSLProgram::applyUniformBlockBindings() {
+    for (const auto &block : uniformBlockBindings) {
+        GLuint blockIndex = glGetUniformBlockIndex(handle, block.first.c_str());
+        if (blockIndex != GL_INVALID_INDEX) {
+            glUniformBlockBinding(handle, blockIndex, block.second);
+        }
+    }
+#ifndef __APPLE__
+    // storage blocks need 4.3
+    for (const auto &block : storageBlockBindings) {
+        GLuint blockIndex = glGetProgramResourceIndex(handle, GL_SHADER_STORAGE_BLOCK, block.first.c_str());
+        if (blockIndex != GL_INVALID_INDEX) {
+            glShaderStorageBlockBinding(handle, blockIndex, block.second);
+        }
+    }
+#endif
 }
 
 void GLSLProgram::setUniform(const char *name, float x, float y, float z) {
@@ -311,7 +659,108 @@ void GLSLProgram::setUniform(const char *name, bool val) {
     glUniform1i(loc, val);
 }
 
+void GLSLProgram::setUniform(UniformHandle uniform, float x, float y, float z) {
+    GLint loc = getUniformLocation(uniform);
+    glUniform3f(loc, x, y, z);
+}
+
+void GLSLProgram::setUniform(UniformHandle uniform, const glm::vec3 &v) {
+    GLint loc = getUniformLocation(uniform);
+    glUniform3f(loc, v.x, v.y, v.z);
+}
+
+void GLSLProgram::setUniform(UniformHandle uniform, const glm::vec4 &v) {
+    GLint loc = getUniformLocation(uniform);
+    glUniform4f(loc, v.x, v.y, v.z, v.w);
+}
+
+void GLSLProgram::setUniform(UniformHandle uniform, const glm::vec2 &v) {
+    GLint loc = getUniformLocation(uniform);
+    glUniform2f(loc, v.x, v.y);
+}
+
+void GLSLProgram::setUniform(UniformHandle uniform, const glm::mat4 &m) {
+    GLint loc = getUniformLocation(uniform);
+    glUniformMatrix4fv(loc, 1, GL_FALSE, &m[0][0]);
+}
+
+void GLSLProgram::setUniform(UniformHandle uniform, const glm::mat3 &m) {
+    GLint loc = getUniformLocation(uniform);
+    glUniformMatrix3fv(loc, 1, GL_FALSE, &m[0][0]);
+}
+
+void GLSLProgram::setUniform(UniformHandle uniform, float val) {
+    GLint loc = getUniformLocation(uniform);
+    glUniform1f(loc, val);
+}
+
+void GLSLProgram::setUniform(UniformHandle uniform, int val) {
+    GLint loc = getUniformLocation(uniform);
+    glUniform1i(loc, val);
+}
+
+void GLSLProgram::setUniform(UniformHandle uniform, GLuint val) {
+    GLint loc = getUniformLocation(uniform);
+    glUniform1ui(loc, val);
+}
+
+void GLSLProgram::setUniform(UniformHandle uniform, bool val) {
+    GLint loc = getUniformLocation(uniform);
+    glUniform1i(loc, val);
+}
+
+void GLSLProgram::setUniform(const UniformName &name, float x, float y, float z) {
+    GLint loc = getUniformLocation(name);
+    glUniform3f(loc, x, y, z);
+}
+
+void GLSLProgram::setUniform(const UniformName &name, const glm::vec3 &v) {
+    GLint loc = getUniformLocation(name);
+    glUniform3f(loc, v.x, v.y, v.z);
+}
+
+void GLSLProgram::setUniform(const UniformName &name, const glm::vec4 &v) {
+    GLint loc = getUniformLocation(name);
+    glUniform4f(loc, v.x, v.y, v.z, v.w);
+}
+
+void GLSLProgram::setUniform(const UniformName &name, const glm::vec2 &v) {
+    GLint loc = getUniformLocation(name);
+    glUniform2f(loc, v.x, v.y);
+}
+
+void GLSLProgram::setUniform(const UniformName &name, const glm::mat4 &m) {
+    GLint loc = getUniformLocation(name);
+    glUniformMatrix4fv(loc, 1, GL_FALSE, &m[0][0]);
+}
+
+void GLSLProgram::setUniform(const UniformName &name, const glm::mat3 &m) {
+    GLint loc = getUniformLocation(name);
+    glUniformMatrix3fv(loc, 1, GL_FALSE, &m[0][0]);
+}
+
+void GLSLProgram::setUniform(const UniformName &name, float val) {
+    GLint loc = getUniformLocation(name);
+    glUniform1f(loc, val);
+}
+
+void GLSLProgram::setUniform(const UniformName &name, int val) {
+    GLint loc = getUniformLocation(name);
+    glUniform1i(loc, val);
+}
+
+void GLSLProgram::setUniform(const UniformName &name, GLuint val) {
+    GLint loc = getUniformLocation(name);
+    glUniform1ui(loc, val);
+}
+
+void GLSLProgram::setUniform(const UniformName &name, bool val) {
+    GLint loc = getUniformLocation(name);
+    glUniform1i(loc, val);
+}
+
 void GLSLProgram::printActiveUniforms() {
+    finishLink();
 #ifdef __APPLE__
     // For OpenGL 4.1, use glGetActiveUniform
     GLint nUniforms, size, location, maxLen;
@@ -356,6 +805,7 @@ void GLSLProgram::printActiveUniforms() {
 }
 
 void GLSLProgram::printActiveUniformBlocks() {
+    finishLink();
 #ifdef __APPLE__
     // For OpenGL 4.1, use glGetActiveUniformBlockiv
     GLint written, maxLength, maxUniLen, nBlocks, binding;
@@ -431,6 +881,7 @@ void GLSLProgram::printActiveUniformBlocks() {
 }
 
 void GLSLProgram::printActiveAttribs() {
+    finishLink();
 #ifdef __APPLE__
     // For OpenGL 4.1, use glGetActiveAttrib
     GLint written, size, location, maxLength, nAttribs;
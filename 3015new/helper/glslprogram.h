@@ -8,8 +8,13 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <memory>
 #include <glm/glm.hpp>
 #include <stdexcept>
+#include <type_traits>
 
 class GLSLProgramException : public std::runtime_error {
 public:
@@ -17,6 +22,28 @@ public:
             std::runtime_error(msg) {}
 };
 
+// Handle to a uniform, resolved once after link() and valid across relinks
+struct UniformHandle {
+    int slot = -1;
+};
+
+// Uniform name with its FNV-1a hash, e.g. UNIFORM_NAME("uModelMatrix")
+struct UniformName {
+    uint32_t hash;
+    const char *name;
+
+    static constexpr uint32_t fnv1a(const char *str, uint32_t h = 2166136261u) {
+        return *str ? fnv1a(str + 1, (h ^ static_cast<uint8_t>(*str)) * 16777619u) : h;
+    }
+
+    constexpr UniformName(uint32_t hash, const char *name) : hash(hash), name(name) {}
+    // Hashed at run time, for names that are not literals
+    explicit constexpr UniformName(const char *str) : hash(fnv1a(str)), name(str) {}
+};
+
+// The hash is a template argument, so the compiler computes it even where the call is not constant-evaluated
+#define UNIFORM_NAME(str) UniformName(std::integral_constant<uint32_t, UniformName::fnv1a(str)>::value, str)
+
 namespace GLSLShader {
     enum GLSLShaderType {
         VERTEX = GL_VERTEX_SHADER,
@@ -28,16 +55,68 @@ namespace GLSLShader {
     };
 };
 
+// Header of a cached program binary (<first stage dir>/<key>.program)
+struct ProgramBinaryHeader {
+    char magic[4];          // "GLPB"
+    uint32_t version;
+    uint64_t key;           // hash of every stage source and the driver strings
+    uint32_t binaryFormat;  // from glGetProgramBinary
+    uint32_t binarySize;    // bytes following the header
+};
+
 class GLSLProgram {
 private:
+    // Stage source kept until link(), which may not need to compile it at all
+    struct PendingStage {
+        GLSLShader::GLSLShaderType type;
+        std::string source;
+        std::string fileName;
+        GLuint shader = 0;      // compiled shader object, until the link completes
+    };
+
     GLuint handle;
     bool linked;
+    bool linkPending = false;   // glLinkProgram issued, status not checked yet
+    std::vector<PendingStage> pendingStages;
+    uint64_t binaryKey = 0;     // written to binaryFile once a pending link succeeds
+    std::string binaryFile;
+    // attribute and fragment output bindings, part of the cache key and replayed on reload
+    std::vector<std::pair<std::string, GLuint>> attribBindings;
+    std::vector<std::pair<std::string, GLuint>> fragDataBindings;
+    // every stage's file, so the program can be rebuilt when one changes
+    std::vector<std::pair<std::string, GLSLShader::GLSLShaderType>> sourceFiles;
+    std::unique_ptr<GLSLProgram> reloading;    // replacement being compiled
+    std::string defines;        // "#define" lines injected into every stage after #version
     std::map<std::string, int> uniformLocations;
+    // the name is kept so two uniforms sharing a hash are caught rather than one shadowing the other
+    struct HashedLocation {
+        std::string name;
+        GLint location;
+    };
+    std::unordered_map<uint32_t, HashedLocation> hashedLocations;
+    std::vector<std::string> handleNames;
+    std::vector<GLint> handleLocations;
+    std::map<std::string, GLuint> uniformBlockBindings;
+    std::map<std::string, GLuint> storageBlockBindings;
 
     inline GLint getUniformLocation(const char *name);
+    inline GLint getUniformLocation(UniformHandle uniform);
+    inline GLint getUniformLocation(const UniformName &name);
+    void resolveUniformHandles();
+    void applyUniformBlockBindings();
 	void detachAndDeleteShaderObjects();
+    void compilePendingStages();
+    std::string getCompileErrors();
+    void finishLink();
+    static void initParallelCompile();
+    static bool parallelCompileSupported;
+    uint64_t getBinaryKey();
+    std::string getBinaryFile(uint64_t key);
+    bool loadBinary(const std::string &binaryFile, uint64_t key);
+    void saveBinary(const std::string &binaryFile, uint64_t key);
     bool fileExists(const std::string &fileName);
     std::string getExtension(const char *fileName);
+    GLSLShader::GLSLShaderType getShaderType(const char *fileName);
 
 public:
     GLSLProgram();
@@ -51,8 +130,27 @@ public:
     void compileShader(const char *fileName, GLSLShader::GLSLShaderType type);
     void compileShader(const std::string &source, GLSLShader::GLSLShaderType type,
                        const char *fileName = NULL);
+    // Define a preprocessor symbol in every stage compiled after this call, e.g. to select a variant
+    void addDefine(const char *name);
+
+    // Stages are compiled by link(), unless a cached program binary for the same sources is found
+    // Source already in memory (e.g. a mapped archive), type from the file name's extension
+    void compileShaderFromMemory(const char *source, size_t length, const char *fileName);
+    void compileShaderFromMemory(const char *source, size_t length, GLSLShader::GLSLShaderType type,
+                                 const char *fileName = NULL);
 
+    // Issues the link without waiting; errors are thrown on first use, or by isLinked()
     void link();
+    // True once the program can be used without blocking on the compiler
+    bool isReady();
+
+    // Rebuild from the source files; the current program stays in use until the new one is ready
+    void reload();
+    // Call between frames; swaps in a reloaded program once compiled, true if the handle changed
+    // Uniform handles and block bindings carry over, plain uniform values must be set again
+    bool updateReload();
+    bool usesFile(const std::string &fileName) const;
+    const std::vector<std::pair<std::string, GLSLShader::GLSLShaderType>> &getSourceFiles() const { return sourceFiles; }
     void validate();
     void use();
 
@@ -61,6 +159,8 @@ public:
 
     void bindAttribLocation(GLuint location, const char *name);
     void bindFragDataLocation(GLuint location, const char *name);
+    void bindUniformBlock(const char *blockName, GLuint binding);
+    void bindStorageBlock(const char *blockName, GLuint binding);
 
     void setUniform(const char *name, float x, float y, float z);
     void setUniform(const char *name, const glm::vec2 &v);
@@ -73,6 +173,31 @@ public:
     void setUniform(const char *name, bool val);
     void setUniform(const char *name, GLuint val);
 
+    // Resolve a uniform once and set it by handle afterwards
+    UniformHandle getUniformHandle(const char *name);
+
+    void setUniform(UniformHandle uniform, float x, float y, float z);
+    void setUniform(UniformHandle uniform, const glm::vec2 &v);
+    void setUniform(UniformHandle uniform, const glm::vec3 &v);
+    void setUniform(UniformHandle uniform, const glm::vec4 &v);
+    void setUniform(UniformHandle uniform, const glm::mat4 &m);
+    void setUniform(UniformHandle uniform, const glm::mat3 &m);
+    void setUniform(UniformHandle uniform, float val);
+    void setUniform(UniformHandle uniform, int val);
+    void setUniform(UniformHandle uniform, bool val);
+    void setUniform(UniformHandle uniform, GLuint val);
+
+    void setUniform(const UniformName &name, float x, float y, float z);
+    void setUniform(const UniformName &name, const glm::vec2 &v);
+    void setUniform(const UniformName &name, const glm::vec3 &v);
+    void setUniform(const UniformName &name, const glm::vec4 &v);
+    void setUniform(const UniformName &name, const glm::mat4 &m);
+    void setUniform(const UniformName &name, const glm::mat3 &m);
+    void setUniform(const UniformName &name, float val);
+    void setUniform(const UniformName &name, int val);
+    void setUniform(const UniformName &name, bool val);
+    void setUniform(const UniformName &name, GLuint val);
+
     void findUniformLocations();
     void printActiveUniforms();
     void printActiveUniformBlocks();
@@ -93,3 +218,21 @@ int GLSLProgram::getUniformLocation(const char *name) {
 	return pos->second;
 }
 
+int GLSLProgram::getUniformLocation(UniformHandle uniform) {
+	if (uniform.slot < 0 || uniform.slot >= static_cast<int>(handleLocations.size()))
+		return -1;
+
+	return handleLocations[uniform.slot];
+}
+
+int GLSLProgram::getUniformLocation(const UniformName &name) {
+	auto pos = hashedLocations.find(name.hash);
+
+	if (pos == hashedLocations.end()) {
+		GLint loc = glGetUniformLocation(handle, name.name);
+		hashedLocations[name.hash] = { name.name, loc };
+		return loc;
+	}
+
+	return pos->second.location;
+}
@@ -2,6 +2,7 @@
 #include <glad/glad.h>
 
 #include <cstdio>
+#include <cstring>
 #include <string>
 using std::string;
 #include <iostream>
@@ -160,4 +161,14 @@ void dumpGLInfo(bool dumpExtensions) {
     }
 }
 
+bool hasExtension(const char *name) {
+    GLint nExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &nExtensions);
+    for( int i = 0; i < nExtensions; i++ ) {
+        if( strcmp(reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i)), name) == 0 )
+            return true;
+    }
+    return false;
+}
+
 } // namespace GLUtils
@@ -7,6 +7,9 @@ namespace GLUtils
     int checkForOpenGLError(const char *, int);
     
     void dumpGLInfo(bool dumpExtensions = false);
+
+    // true if the current context lists the extension
+    bool hasExtension(const char *name);
     
     void APIENTRY debugCallback( GLenum source, GLenum type, GLuint id,
 		GLenum severity, GLsizei length, const GLchar * msg, const void * param );
@@ -2,6 +2,10 @@
 
 #include <glm/glm.hpp>
 
+#include <string>
+#include <utility>
+#include <vector>
+
 class Scene
 {
 protected:
@@ -39,6 +43,16 @@ public:
       Called when screen is resized
       */
     virtual void resize(int, int) = 0;
+
+    /**
+      Rolling GPU time per render pass in milliseconds, if the scene profiles any.
+      */
+    virtual std::vector<std::pair<std::string, double>> getGpuTimings() { return {}; }
+
+    /**
+      True while assets are still streaming in.
+      */
+    virtual bool isLoading() { return false; }
     
     void animate( bool value ) { m_animate = value; }
     bool animating() { return m_animate; }
@@ -2,6 +2,7 @@
 #include "scene.h"
 #include <GLFW/glfw3.h>
 #include "glutils.h"
+#include "GLState.h"
 
 #define WIN_WIDTH 800
 #define WIN_HEIGHT 600
@@ -10,18 +11,56 @@
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Settings for the headless fixed-frame benchmark (--benchmark)
+struct BenchmarkSettings {
+    bool enabled = false;
+    int frames = 500;               // measured frames
+    int warmupFrames = 10;          // frames rendered before measuring
+    float timestep = 1.0f / 60.0f;  // deterministic time step fed to Scene::update
+    int contextApi = GLFW_NATIVE_CONTEXT_API;
+    std::string outputFile;         // JSON goes to stdout when empty, everything else to stderr
+};
 
 class SceneRunner {
 private:
     GLFWwindow * window;
     int fbw, fbh;
 	bool debug;           // Set true to enable debug messages
+    BenchmarkSettings benchmark;
+    int reportFd;         // The real stdout while diagnostics are sent to stderr, -1 otherwise
+
+    // Number of GL_TIME_ELAPSED queries in flight, results are read this many frames late
+    static const int QUERY_LATENCY = 4;
 
 public:
-    SceneRunner(const std::string & windowTitle, int width = WIN_WIDTH, int height = WIN_HEIGHT, int samples = 0) : debug(true) {
+    SceneRunner(const std::string & windowTitle, int width = WIN_WIDTH, int height = WIN_HEIGHT, int samples = 0,
+                const BenchmarkSettings & benchmarkSettings = BenchmarkSettings()) : debug(true), benchmark(benchmarkSettings), reportFd(-1) {
+        // Keep stdout for the JSON report alone, whatever the scene and GL info dump print
+        if( benchmark.enabled && benchmark.outputFile.empty() )
+            reportFd = redirectStdout();
+
         // Initialize GLFW
         if( !glfwInit() ) exit( EXIT_FAILURE );
 
+        if( benchmark.enabled ) {
+            // Render offscreen, the window only provides the context
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, benchmark.contextApi);
+            debug = false;
+        }
+
 #ifdef __APPLE__
         // Select OpenGL 4.1
         glfwWindowHint( GLFW_CONTEXT_VERSION_MAJOR, 4 );
@@ -75,7 +114,10 @@ public:
         scene.resize(fbw, fbh);
 
         // Enter the main loop
-        mainLoop(window, scene);
+        if( benchmark.enabled )
+            benchmarkLoop(scene);
+        else
+            mainLoop(window, scene);
 
 #ifndef __APPLE__
 		if( debug )
@@ -107,6 +149,32 @@ public:
         return recipeName;
     }
 
+    // Parses --benchmark [frames], --warmup <frames>, --timestep <seconds>,
+    // --context <native|egl|osmesa> and --output <file>
+    static BenchmarkSettings parseBenchmarkArgs(int argc, char ** argv) {
+        BenchmarkSettings settings;
+        for( int i = 1; i < argc; i++ ) {
+            bool hasValue = i + 1 < argc;
+            if( strcmp(argv[i], "--benchmark") == 0 ) {
+                settings.enabled = true;
+                if( hasValue && argv[i + 1][0] != '-' )
+                    settings.frames = std::max(1, atoi(argv[++i]));
+            } else if( strcmp(argv[i], "--warmup") == 0 && hasValue ) {
+                settings.warmupFrames = std::max(0, atoi(argv[++i]));
+            } else if( strcmp(argv[i], "--timestep") == 0 && hasValue ) {
+                settings.timestep = static_cast<float>(atof(argv[++i]));
+            } else if( strcmp(argv[i], "--context") == 0 && hasValue ) {
+                std::string api = argv[++i];
+                if( api == "egl" ) settings.contextApi = GLFW_EGL_CONTEXT_API;
+                else if( api == "osmesa" ) settings.contextApi = GLFW_OSMESA_CONTEXT_API;
+                else settings.contextApi = GLFW_NATIVE_CONTEXT_API;
+            } else if( strcmp(argv[i], "--output") == 0 && hasValue ) {
+                settings.outputFile = argv[++i];
+            }
+        }
+        return settings;
+    }
+
 private:
     static void printHelpInfo(const char * exeFile,  std::map<std::string, std::string> & sceneData) {
         printf("Usage: %s recipe-name\n\n", exeFile);
@@ -130,4 +198,186 @@ private:
 				scene.animate(!scene.animating());
         }
     }
+
+    // Points stdout at stderr and returns a descriptor of the original stdout
+    static int redirectStdout() {
+        fflush(stdout);
+#ifdef _WIN32
+        int saved = _dup(_fileno(stdout));
+        _dup2(_fileno(stderr), _fileno(stdout));
+#else
+        int saved = dup(fileno(stdout));
+        dup2(fileno(stderr), fileno(stdout));
+#endif
+        return saved;
+    }
+
+    static void restoreStdout(int saved) {
+        if( saved < 0 ) return;
+        std::cout.flush();
+        fflush(stdout);
+#ifdef _WIN32
+        _dup2(saved, _fileno(stdout));
+        _close(saved);
+#else
+        dup2(saved, fileno(stdout));
+        close(saved);
+#endif
+    }
+
+    // Quotes, backslashes and control characters escaped for a JSON string
+    static std::string jsonEscape(const std::string & text) {
+        std::string escaped;
+        for( char c : text ) {
+            if( c == '"' || c == '\\' ) {
+                escaped += '\\';
+                escaped += c;
+            } else if( static_cast<unsigned char>(c) < 0x20 ) {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    struct TimingStats {
+        double min = 0.0, avg = 0.0, p99 = 0.0;
+    };
+
+    static TimingStats computeStats(std::vector<double> samples) {
+        TimingStats stats;
+        if( samples.empty() ) return stats;
+
+        std::sort(samples.begin(), samples.end());
+        double sum = 0.0;
+        for( double s : samples ) sum += s;
+
+        size_t p99Index = static_cast<size_t>(0.99 * samples.size() + 0.5);
+        stats.min = samples.front();
+        stats.avg = sum / samples.size();
+        stats.p99 = samples[std::min(samples.size() - 1, p99Index > 0 ? p99Index - 1 : 0)];
+        return stats;
+    }
+
+    void benchmarkLoop(Scene & scene) {
+        // Offscreen render target, the scene renders into whatever framebuffer is bound
+        GLuint fbo, colorRbo, depthRbo;
+        glGenFramebuffers(1, &fbo);
+        glGenRenderbuffers(1, &colorRbo);
+        glGenRenderbuffers(1, &depthRbo);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, colorRbo);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, fbw, fbh);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRbo);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, fbw, fbh);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRbo);
+        if( glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE ) {
+            std::cerr << "Benchmark framebuffer is incomplete." << std::endl;
+            exit( EXIT_FAILURE );
+        }
+
+        // Ring of queries so reading GPU times never waits on the current frame
+        GLuint queries[QUERY_LATENCY];
+        glGenQueries(QUERY_LATENCY, queries);
+
+        // Measure the final scene, not placeholders
+        while( scene.isLoading() ) {
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            scene.update(0.0f);
+            scene.render();
+            glfwPollEvents();
+        }
+
+        int totalFrames = benchmark.warmupFrames + benchmark.frames;
+        std::vector<double> cpuTimes, gpuTimes;
+        cpuTimes.reserve(benchmark.frames);
+        gpuTimes.reserve(benchmark.frames);
+
+        auto readGpuTime = [&](int frame) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries[frame % QUERY_LATENCY], GL_QUERY_RESULT, &elapsed);
+            if( frame >= benchmark.warmupFrames )
+                gpuTimes.push_back(elapsed / 1.0e6);
+        };
+
+        for( int frame = 0; frame < totalFrames; frame++ ) {
+            // Collect the query issued QUERY_LATENCY frames ago before reusing it
+            if( frame >= QUERY_LATENCY )
+                readGpuTime(frame - QUERY_LATENCY);
+
+            // Bind counters cover the measured frames only
+            if( frame == benchmark.warmupFrames )
+                GLState::resetCounters();
+
+            auto cpuStart = std::chrono::high_resolution_clock::now();
+            glBeginQuery(GL_TIME_ELAPSED, queries[frame % QUERY_LATENCY]);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            scene.update(frame * benchmark.timestep);
+            scene.render();
+
+            glEndQuery(GL_TIME_ELAPSED);
+            auto cpuEnd = std::chrono::high_resolution_clock::now();
+
+            if( frame >= benchmark.warmupFrames )
+                cpuTimes.push_back(std::chrono::duration<double, std::milli>(cpuEnd - cpuStart).count());
+
+            glfwPollEvents();
+        }
+
+        // Drain the remaining queries
+        for( int frame = std::max(0, totalFrames - QUERY_LATENCY); frame < totalFrames; frame++ )
+            readGpuTime(frame);
+
+        GLUtils::checkForOpenGLError(__FILE__,__LINE__);
+
+        writeBenchmarkReport(computeStats(cpuTimes), computeStats(gpuTimes), scene.getGpuTimings());
+
+        glDeleteQueries(QUERY_LATENCY, queries);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteRenderbuffers(1, &depthRbo);
+        glDeleteRenderbuffers(1, &colorRbo);
+        glDeleteFramebuffers(1, &fbo);
+    }
+
+    void writeBenchmarkReport(const TimingStats & cpu, const TimingStats & gpu,
+                              const std::vector<std::pair<std::string, double>> & passes) {
+        const char * renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+
+        std::string json = "{\n";
+        json += "  \"renderer\": \"" + jsonEscape(renderer ? renderer : "") + "\",\n";
+        json += "  \"width\": " + std::to_string(fbw) + ",\n";
+        json += "  \"height\": " + std::to_string(fbh) + ",\n";
+        json += "  \"frames\": " + std::to_string(benchmark.frames) + ",\n";
+        json += "  \"warmup_frames\": " + std::to_string(benchmark.warmupFrames) + ",\n";
+        json += "  \"timestep\": " + std::to_string(benchmark.timestep) + ",\n";
+        json += "  \"cpu_ms\": { \"min\": " + std::to_string(cpu.min) + ", \"avg\": " + std::to_string(cpu.avg) +
+                ", \"p99\": " + std::to_string(cpu.p99) + " },\n";
+        json += "  \"gpu_ms\": { \"min\": " + std::to_string(gpu.min) + ", \"avg\": " + std::to_string(gpu.avg) +
+                ", \"p99\": " + std::to_string(gpu.p99) + " },\n";
+        json += "  \"gpu_pass_avg_ms\": {";
+        for( size_t i = 0; i < passes.size(); i++ ) {
+            json += (i == 0 ? " \"" : ", \"") + jsonEscape(passes[i].first) + "\": " + std::to_string(passes[i].second);
+        }
+        json += " },\n";
+        double frames = std::max(1, benchmark.frames);
+        json += "  \"gl_binds_per_frame\": { \"issued\": " + std::to_string(GLState::getIssued() / frames) +
+                ", \"elided\": " + std::to_string(GLState::getElided() / frames) + " }\n";
+        json += "}\n";
+
+        if( benchmark.outputFile.empty() ) {
+            restoreStdout(reportFd);
+            reportFd = -1;
+            std::cout << json;
+        } else {
+            std::ofstream out(benchmark.outputFile);
+            out << json;
+        }
+    }
 };
@@ -52,6 +52,13 @@ struct VertexNormTanTex
 	GLfloat texCoord[2];
 };
 
+// instance attribute format
+struct InstanceMatrices
+{
+	GLfloat modelMatrix[16];
+	GLfloat normalMatrix[9];
+};
+
 // light properties
 struct Light
 {
@@ -65,6 +72,56 @@ struct Light
 	float outerAngle;	// spotlight: outer angle
 	int type;			// light source: 0=off; 1=point; 2=directional; 3=spotlight
 
+	// GPU layout of the light (std140, and std430 in arrays), matches struct Light in the shaders
+	struct Block
+	{
+		glm::vec3 pos;
+		float innerAngle;	// radians
+		glm::vec3 dir;
+		float outerAngle;	// radians
+		glm::vec3 La;
+		int type;
+		glm::vec3 Ld;
+		float range;		// 0 when unbounded
+		glm::vec3 Ls;
+		float pad1;
+		glm::vec3 att;
+		float pad2;
+	};
+
+	Block toBlock() const
+	{
+		Block block = {};
+		block.pos = pos;
+		block.innerAngle = glm::radians(innerAngle);
+		block.dir = dir;
+		block.outerAngle = glm::radians(outerAngle);
+		block.La = La;
+		block.type = type;
+		block.Ld = Ld;
+		block.range = getRange();
+		block.Ls = Ls;
+		block.att = att;
+		return block;
+	}
+
+	// distance at which the attenuated light drops below one 8-bit step, or 0 for
+	// directional lights and lights without linear or quadratic falloff
+	float getRange() const
+	{
+		if (type == 2 || (att.y <= 0.0f && att.z <= 0.0f))
+			return 0.0f;
+
+		// solve att.x + att.y * d + att.z * d^2 = brightest / threshold for d
+		float brightest = glm::max(glm::max(Ld.x, Ld.y), glm::max(Ld.z, glm::max(Ls.x, glm::max(Ls.y, Ls.z))));
+		float c = att.x - brightest * 256.0f;
+		if (c >= 0.0f)
+			return 0.0001f;
+		if (att.z <= 0.0f)
+			return -c / att.y;
+		return (-att.y + glm::sqrt(att.y * att.y - 4.0f * att.z * c)) / (2.0f * att.z);
+	}
+
 	// set shader uniform variables based on type of light source
 	void setLightUniforms(GLSLProgram& shader, std::string prefix, bool on = true)
 	{
@@ -132,7 +189,43 @@ struct Material
 	glm::vec3 Ks;		// specular reflection coefficient
 	glm::vec3 emission;	// light source emission component (point light/spotlight)
 	float shininess;	// specular reflection shininess exponent
+
+	// GPU layout of the material (std140), shininess packs into the padding after Ks
+	struct Block
+	{
+		glm::vec3 Ka;
+		float pad0;
+		glm::vec3 Kd;
+		float pad1;
+		glm::vec3 Ks;
+		float shininess;
+	};
+
+	Block toBlock() const
+	{
+		Block block = {};
+		block.Ka = Ka;
+		block.Kd = Kd;
+		block.Ks = Ks;
+		block.shininess = shininess;
+		return block;
+	}
 };
 
+// per-frame uniform block (std140), matches FrameBlock in the shaders
+struct FrameBlock
+{
+	glm::mat4 viewMatrix;
+	glm::mat4 projectionMatrix;
+	glm::mat4 viewProjectionMatrix;
+	glm::vec3 viewpoint;
+	float pad0;
+	Light::Block light;
+};
+
+static_assert(sizeof(Light::Block) == 96, "Light::Block must match the std140 layout");
+static_assert(sizeof(Material::Block) == 48, "Material::Block must match the std140 layout");
+static_assert(sizeof(FrameBlock) == 304, "FrameBlock must match the std140 layout");
+
 
 #endif
\ No newline at end of file
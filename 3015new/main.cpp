@@ -1,11 +1,29 @@
 #include "helper/scene.h"
 #include "helper/scenerunner.h"
 #include "scenebasic_uniform.h"
+#include "helper/AssetArchive.h"
+#include "helper/Texture.h"
+
+#include <cstring>
+#include <memory>
 
 
 int main(int argc, char* argv[])
 {
-	SceneRunner runner("Shader_Basics");
+	// before the packer or the texture streamer start decoding on other threads
+	Texture::initImageLoading();
+
+	// --pack [archive] [manifest] cooks the assets offline, no window is created
+	if (argc > 1 && strcmp(argv[1], "--pack") == 0)
+	{
+		const char* archive = argc > 2 ? argv[2] : "media/assets.pak";
+		const char* manifest = argc > 3 ? argv[3] : "media/assets.txt";
+		return AssetArchive::pack(archive, manifest) ? 0 : 1;
+	}
+
+	BenchmarkSettings benchmark = SceneRunner::parseBenchmarkArgs(argc, argv);
+
+	SceneRunner runner("Shader_Basics", WIN_WIDTH, WIN_HEIGHT, 0, benchmark);
 
 	std::unique_ptr<Scene> scene;
 
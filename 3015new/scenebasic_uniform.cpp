@@ -35,11 +35,11 @@ void SceneBasic_Uniform::initScene(GLFWwindow* inWindow)
 	glfwSetCursorPosCallback(window, cursor_position_callback);
 	glfwSetMouseButtonCallback(window, mouse_button_callback);
 
-    compile();
-
-    std::cout << std::endl;
+	// cooked assets from "<exe> --pack", loose files are used for anything it does not hold
+	if (gArchive.open("media/assets.pak"))
+		std::cout << "Using asset archive media/assets.pak" << std::endl;
 
-    prog.printActiveUniforms();
+    compile();
 
     /////////////////// Create the VBO ////////////////////
     float positionData[] = {
@@ -65,7 +65,7 @@ void SceneBasic_Uniform::initScene(GLFWwindow* inWindow)
 
     // Create and set-up the vertex array object
     glGenVertexArrays( 1, &vaoHandle );
-    glBindVertexArray(vaoHandle);
+    GLState::bindVertexArray(vaoHandle);
 
     glEnableVertexAttribArray(0);  // Vertex position
     glEnableVertexAttribArray(1);  // Vertex color
@@ -85,25 +85,156 @@ void SceneBasic_Uniform::initScene(GLFWwindow* inWindow)
     		glVertexAttribFormat(1, 3, GL_FLOAT, GL_FALSE, 0);
     	  glVertexAttribBinding(1, 1);
     #endif
-    glBindVertexArray(0);
+    GLState::bindVertexArray(0);
 
-	// compile and link a vertex and fragment shader pair
-	gNormalMapShader.compileShader("shader/normalMap.vert");
-	gNormalMapShader.compileShader("shader/normalMap.frag");
-	gNormalMapShader.link();
+	// initialise point light properties
+	gLight.pos = glm::vec3(0.0f, 3.0f, 0.0f);
+	gLight.dir = glm::vec3(0.3f, -0.7f, -0.5f);
+	gLight.La = glm::vec3(0.3f);
+	gLight.Ld = glm::vec3(1.0f);
+	gLight.Ls = glm::vec3(1.0f);
+	gLight.att = glm::vec3(1.0f, 0.0f, 0.0f);
+	gLight.innerAngle = 0.0f;
+	gLight.outerAngle = 0.0f;
+	gLight.type = 1;
+
+	// one lighting source pair, compiled per feature set so unused paths cost nothing
+	gLightingVariants.setSources("shader/phong.vert", "shader/phong.frag",
+		{ "TEXTURE", "NORMAL_MAP", "INSTANCED", "ENV_MAP", "DIRECTIONAL_LIGHT", "ATTENUATION", "INDIRECT", "CLUSTERED",
+		  "SHADOWS", "DEPTH_ONLY", "LAYERED", "POINT_SHADOWS", "GBUFFER", "DEFERRED" });
+	gLightingVariants.setGeometrySource("shader/pointShadow.geom", LIGHTING_LAYERED);
+	gLightingVariants.setLoader([this](GLSLProgram& shader, const char* fileName) { loadShader(shader, fileName); });
+
+	// attach the shared uniform blocks to their fixed binding points
+	gLightingVariants.bindUniformBlock("FrameBlock", FRAME_BLOCK_BINDING);
+	gLightingVariants.bindUniformBlock("MaterialBlock", MATERIAL_BLOCK_BINDING);
+	gLightingVariants.bindStorageBlock("DrawBlock", DRAW_DATA_BINDING);
+	gLightingVariants.bindUniformBlock("ClusterBlock", CLUSTER_BLOCK_BINDING);
+	gLightingVariants.bindUniformBlock("ShadowBlock", SHADOW_BLOCK_BINDING);
+	gLightingVariants.bindUniformBlock("PointShadowBlock", POINT_SHADOW_BLOCK_BINDING);
+	gLightingVariants.bindStorageBlock("LightBlock", LIGHT_BINDING);
+	gLightingVariants.bindStorageBlock("ClusterCountBlock", CLUSTER_COUNT_BINDING);
+	gLightingVariants.bindStorageBlock("ClusterIndexBlock", CLUSTER_INDEX_BINDING);
+
+	// the light is fixed, so its attenuation is a compile-time choice; it always casts cube shadows
+	uint32_t pointLight = ((gLight.att.y != 0.0f || gLight.att.z != 0.0f) ? LIGHTING_ATTENUATION : 0) | LIGHTING_POINT_SHADOWS;
+	gNormalMapShader = &gLightingVariants.get(LIGHTING_TEXTURE | LIGHTING_NORMAL_MAP | LIGHTING_INSTANCED | pointLight);
+	gBasicLightingShader = &gLightingVariants.get(LIGHTING_TEXTURE | pointLight);
+	gCubemapShader = &gLightingVariants.get(LIGHTING_ENV_MAP | LIGHTING_DIRECTIONAL | LIGHTING_SHADOWS);
+
+	// shadow casters write depth alone, so only the vertex path tells the variants apart
+	gLightingVariants.get(LIGHTING_DEPTH_ONLY | LIGHTING_INSTANCED);
+	gLightingVariants.get(LIGHTING_DEPTH_ONLY);
+	gLightingVariants.get(LIGHTING_DEPTH_ONLY | LIGHTING_LAYERED | LIGHTING_INSTANCED);
+	gLightingVariants.get(LIGHTING_DEPTH_ONLY | LIGHTING_LAYERED);
+
+	// static geometry variants only compile where multi-draw indirect can run them
+	bool indirectSupported = StaticGeometry::isSupported();
+	if (indirectSupported)
+	{
+		gLightingVariants.get(LIGHTING_TEXTURE | LIGHTING_NORMAL_MAP | LIGHTING_INDIRECT | pointLight);
+		gLightingVariants.get(LIGHTING_TEXTURE | LIGHTING_INDIRECT | pointLight);
+		gLightingVariants.get(LIGHTING_DEPTH_ONLY | LIGHTING_INDIRECT);
+		gLightingVariants.get(LIGHTING_DEPTH_ONLY | LIGHTING_LAYERED | LIGHTING_INDIRECT);
+	}
 
-	gBasicLightingShader.compileShader("shader/basicLighting.vert");
-	gBasicLightingShader.compileShader("shader/basicLighting.frag");
-	gBasicLightingShader.link();
+	// the deferred path writes the G-buffer through the same vertex paths and lights it in one full-screen pass;
+	// whether the target can take it is only known once render() sees the target
+	gLightingVariants.get(LIGHTING_TEXTURE | LIGHTING_NORMAL_MAP | LIGHTING_INSTANCED | LIGHTING_GBUFFER);
+	gLightingVariants.get(LIGHTING_TEXTURE | LIGHTING_GBUFFER);
+	if (indirectSupported)
+	{
+		gLightingVariants.get(LIGHTING_TEXTURE | LIGHTING_NORMAL_MAP | LIGHTING_INDIRECT | LIGHTING_GBUFFER);
+		gLightingVariants.get(LIGHTING_TEXTURE | LIGHTING_INDIRECT | LIGHTING_GBUFFER);
+	}
+	gDeferredShader = &gLightingVariants.get(LIGHTING_DEFERRED | pointLight);
 
-	gCubemapShader.compileShader("shader/lighting.vert");
-	gCubemapShader.compileShader("shader/lighting_cubemap.frag");
-	gCubemapShader.link();
+	// the same programs lit by every light in their cluster, which is binned by a compute pass
+	bool clusteredSupported = LightClusters::isSupported();
+	if (clusteredSupported)
+	{
+		gLightingVariants.get(LIGHTING_TEXTURE | LIGHTING_NORMAL_MAP | LIGHTING_INSTANCED | LIGHTING_CLUSTERED);
+		gLightingVariants.get(LIGHTING_TEXTURE | LIGHTING_CLUSTERED);
+		if (indirectSupported)
+		{
+			gLightingVariants.get(LIGHTING_TEXTURE | LIGHTING_NORMAL_MAP | LIGHTING_INDIRECT | LIGHTING_CLUSTERED);
+			gLightingVariants.get(LIGHTING_TEXTURE | LIGHTING_INDIRECT | LIGHTING_CLUSTERED);
+		}
+		gDeferredClusteredShader = &gLightingVariants.get(LIGHTING_DEFERRED | LIGHTING_CLUSTERED);
+
+		loadShader(gLightClusterShader, "shader/lightCluster.comp");
+		gLightClusterShader.bindUniformBlock("FrameBlock", FRAME_BLOCK_BINDING);
+		gLightClusterShader.bindUniformBlock("ClusterBlock", CLUSTER_BLOCK_BINDING);
+		gLightClusterShader.bindStorageBlock("LightBlock", LIGHT_BINDING);
+		gLightClusterShader.bindStorageBlock("ClusterCountBlock", CLUSTER_COUNT_BINDING);
+		gLightClusterShader.bindStorageBlock("ClusterIndexBlock", CLUSTER_INDEX_BINDING);
+		gLightClusterShader.link();
+	}
 
-	gColorShader.compileShader("shader/modelViewProj.vert");
-	gColorShader.compileShader("shader/color.frag");
+	loadShader(gColorShader, "shader/modelViewProj.vert");
+	loadShader(gColorShader, "shader/color.frag");
 	gColorShader.link();
 
+	loadShader(gPrefilterShader, "shader/cubePrefilter.vert");
+	loadShader(gPrefilterShader, "shader/cubePrefilter.frag");
+	gPrefilterShader.link();
+
+	// static geometry culled on the GPU, against the frustum and the previous frame's depth
+	if (StaticGeometry::isCullingSupported())
+	{
+		loadShader(gCullShader, "shader/cull.comp");
+		gCullShader.bindStorageBlock("CullDataBlock", CULL_DATA_BINDING);
+		gCullShader.bindStorageBlock("CommandBlock", COMMAND_BINDING);
+		gCullShader.bindStorageBlock("VisibleBlock", VISIBLE_COMMAND_BINDING);
+		gCullShader.bindStorageBlock("CountBlock", VISIBLE_COUNT_BINDING);
+		gCullShader.link();
+
+		gPyramidFromDepthShader.addDefine("FROM_DEPTH");
+		loadShader(gPyramidFromDepthShader, "shader/depthPyramid.comp");
+		gPyramidFromDepthShader.link();
+		loadShader(gPyramidReduceShader, "shader/depthPyramid.comp");
+		gPyramidReduceShader.link();
+	}
+
+	// every program is submitted before the first one is waited on here
+	std::cout << std::endl;
+
+	// compile() only issued the link, so prog's errors surface at this first wait
+	try {
+		prog.printActiveUniforms();
+	} catch (GLSLProgramException &e) {
+		cerr << e.what() << endl;
+		exit(EXIT_FAILURE);
+	}
+
+	// resolve uniform handles once so rendering avoids name lookups
+	gNormalMapUniforms.resolve(*gNormalMapShader);
+	gBasicLightingUniforms.resolve(*gBasicLightingShader);
+	gCubemapUniforms.resolve(*gCubemapShader);
+
+	// the render queue sorts draws by these indices
+	gForwardPrograms = registerLightingPrograms(pointLight, indirectSupported);
+	gCubemapProgram = gRenderQueue.registerProgram(*gCubemapShader);
+	if (clusteredSupported)
+		gClusteredPrograms = registerLightingPrograms(LIGHTING_CLUSTERED, indirectSupported);
+	gShadowPrograms = registerShadowPrograms(indirectSupported);
+	gPointShadowPrograms = registerPointShadowPrograms(indirectSupported);
+	gGBufferPrograms = registerLightingPrograms(LIGHTING_GBUFFER, indirectSupported);
+	// never drawn through the queue, registered so their shadow map units are restored after a reload
+	gRenderQueue.registerProgram(*gDeferredShader, false);
+	if (gDeferredClusteredShader)
+		gRenderQueue.registerProgram(*gDeferredClusteredShader, false);
+
+	// the reflective torus is lit by the directional light on every path
+	gForwardPrograms.cubemap = gCubemapProgram;
+	gClusteredPrograms.cubemap = gCubemapProgram;
+
+	// rebuild programs when their sources are saved
+	for (GLSLProgram* shader : getWatchedPrograms())
+	{
+		for (const auto& file : shader->getSourceFiles())
+			gShaderWatcher.watch(file.first);
+	}
 
 	// initialise view matrix
 	gViewMatrix = glm::lookAt(glm::vec3(0.0f, 0.0f, 4.0f),
@@ -117,20 +248,34 @@ void SceneBasic_Uniform::initScene(GLFWwindow* inWindow)
 
 	gOrthoMatrix = glm::ortho(0.0f, static_cast<float>(width), 0.0f, static_cast<float>(height), 0.1f, 10.0f);
 
-	// initialise point light properties
-	gLight.pos = glm::vec3(0.0f, 3.0f, 0.0f);
-	gLight.dir = glm::vec3(0.3f, -0.7f, -0.5f);
-	gLight.La = glm::vec3(0.3f);
-	gLight.Ld = glm::vec3(1.0f);
-	gLight.Ls = glm::vec3(1.0f);
-	gLight.att = glm::vec3(1.0f, 0.0f, 0.0f);
-
 	// initialise material properties
 	gMaterial.Ka = glm::vec3(0.2f);
 	gMaterial.Kd = glm::vec3(1.0f, 1.0f, 1.0f);
 	gMaterial.Ks = glm::vec3(0.2f, 0.7f, 1.0f);
 	gMaterial.shininess = 40.0f;
 
+	// create uniform buffers, material data only changes when the material does
+	gFrameBuffer.create(sizeof(FrameBlock), FRAME_BLOCK_BINDING);
+	gMaterialBuffer.create(sizeof(Material::Block), MATERIAL_BLOCK_BINDING);
+
+	Material::Block materialBlock = gMaterial.toBlock();
+	gMaterialBuffer.update(&materialBlock, sizeof(materialBlock));
+	gDefaultMaterial = gRenderQueue.registerMaterial(gMaterialBuffer);
+
+	// storage for the clustered path, its lights are refreshed every frame
+	if (clusteredSupported)
+		gLightClusters.create();
+
+	// cascade count and resolution can be changed at run time with C and V
+	gShadowCascades.create(3, 2048);
+	// face resolution can be changed at run time with B
+	gPointShadow.create(1024);
+
+	// captured from the torus centre, 6 levels leave the blurriest at 8x8
+	gReflectionProbe.create(256, 6);
+	gReflectionProbe.setPosition(glm::vec3(-1.0f, 1.0f, -1.0f));
+	gReflectionProbe.setBudget(1.0);
+
 	// initialise model matrices
 	gModelMatrix["BackWall1"] = glm::translate(glm::vec3(-2.0f, 0.0f, -3.0f));
 	gModelMatrix["BackWall2"] = glm::translate(glm::vec3(0.0f, 0.0f, -3.0f));
@@ -168,15 +313,19 @@ void SceneBasic_Uniform::initScene(GLFWwindow* inWindow)
 
 	gModelMatrix["Torus"] = glm::translate(glm::vec3(-1.0f, 0.0f, -1.0f));
 	gModelMatrix["Cube"] = glm::translate(glm::vec3(1.0f, 0.0f, 1.0f));
+	gModelMatrix["Crate"] = glm::translate(glm::vec3(1.0f, 1.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
+
+	// load texture and normal map in the background, placeholders are bound meanwhile
+	gTextureStreamer.init();
 
-	// load texture and normal map
-	gTexture["Stone"].generate("./media/images/Fieldstone.bmp");
-	gTexture["StoneNormalMap"].generate("./images/FieldstoneBumpDOT3.bmp");
+	// colour maps are BC1, normal maps keep x and y in BC5
+	loadTexture(gTexture["Stone"], "./media/images/Fieldstone.bmp", COMPRESSION_BC1);
+	loadTexture(gTexture["StoneNormalMap"], "./media/images/FieldstoneBumpDOT3.bmp", COMPRESSION_BC5);
 
-	gTexture["White"].generate("./media/images/White.bmp");
-	gTexture["WhiteNormalMap"].generate("./media/images/WhiteBumpDOT3.bmp");
+	loadTexture(gTexture["White"], "./media/images/White.bmp", COMPRESSION_BC1);
+	loadTexture(gTexture["WhiteNormalMap"], "./media/images/WhiteBumpDOT3.bmp", COMPRESSION_BC5);
 
-	gTexture["Crate"].generate("./media/images/diffuse.bmp");
+	loadTexture(gTexture["Crate"], "./media/images/diffuse.bmp", COMPRESSION_BC1);
 
 	// load cube environment map texture
 	gCubeEnvMap.generate(
@@ -185,53 +334,42 @@ void SceneBasic_Uniform::initScene(GLFWwindow* inWindow)
 		"./media/images/cm_top.bmp", "./media/images/cm_bottom.bmp");
 
 	// load model
-	gTorusModel.loadModel("./media/models/torus.obj", false);
-	gCubeModel.loadModel("./media/models/cube.obj", true);
-
-	// vertex positions, normals, tangents and texture coordinates
-	std::vector<GLfloat> vertices =
-	{
-		-1.0f, -1.0f, 0.0f,	// vertex 0: position
-		0.0f, 0.0f, 1.0f,	// vertex 0: normal
-		1.0f, 0.0f, 0.0f,	// vertex 0: tangent
-		0.0f, 0.0f,			// vertex 0: texture coordinate
-		1.0f, -1.0f, 0.0f,	// vertex 1: position
-		0.0f, 0.0f, 1.0f,	// vertex 1: normal
-		1.0f, 0.0f, 0.0f,	// vertex 1: tangent
-		1.0f, 0.0f,			// vertex 1: texture coordinate
-		-1.0f, 1.0f, 0.0f,	// vertex 2: position
-		0.0f, 0.0f, 1.0f,	// vertex 2: normal
-		1.0f, 0.0f, 0.0f,	// vertex 2: tangent
-		0.0f, 1.0f,			// vertex 2: texture coordinate
-		1.0f, 1.0f, 0.0f,	// vertex 3: position
-		0.0f, 0.0f, 1.0f,	// vertex 3: normal
-		1.0f, 0.0f, 0.0f,	// vertex 3: tangent
-		1.0f, 1.0f,			// vertex 3: texture coordinate
-	};
+	loadModel(gTorusModel, "./media/models/torus.obj", false);
+	loadModel(gCubeModel, "./media/models/cube.obj", true);
 
-	// create VBO
-	glGenBuffers(1, &gVBO);					// generate unused VBO identifier
-	glBindBuffer(GL_ARRAY_BUFFER, gVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+	// pack the wall and floor matrices into per-instance buffers
+	for (const auto& matrix : gModelMatrix)
+	{
+		if (matrix.first.find("Wall") != std::string::npos)
+			gWallQuads.addInstance(matrix.second);
+	}
+	gFloorQuads.addInstance(gModelMatrix["Floor"]);
 
-	// create VAO, specify VBO data and format of the data
-	glGenVertexArrays(1, &gVAO);			// generate unused VAO identifier
-	glBindVertexArray(gVAO);				// create VAO
-	glBindBuffer(GL_ARRAY_BUFFER, gVBO);	// bind the VBO
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormTanTex),
-		reinterpret_cast<void*>(offsetof(VertexNormTanTex, position)));		// specify format of position data
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormTanTex),
-		reinterpret_cast<void*>(offsetof(VertexNormTanTex, normal)));		// specify format of colour data
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(VertexNormTanTex),
-		reinterpret_cast<void*>(offsetof(VertexNormTanTex, tangent)));		// specify format of tangent data
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(VertexNormTanTex),
-		reinterpret_cast<void*>(offsetof(VertexNormTanTex, texCoord)));		// specify format of texture coordinate data
+	gWallQuads.create();
+	gFloorQuads.create();
 
-	glEnableVertexAttribArray(0);	// enable vertex attributes
-	glEnableVertexAttribArray(1);
-	glEnableVertexAttribArray(2);
-	glEnableVertexAttribArray(3);
+	// the same objects again in merged buffers, one command each
+	if (indirectSupported)
+	{
+		int quad = gStaticGeometry.addQuad();
+		int cube = gStaticGeometry.addModel(gCubeModel);
+
+		gWallBatch = gStaticGeometry.addBatch();
+		gFloorBatch = gStaticGeometry.addBatch();
+		gCrateBatch = gStaticGeometry.addBatch();
+
+		for (const auto& matrix : gModelMatrix)
+		{
+			if (matrix.first.find("Wall") != std::string::npos)
+				gStaticGeometry.addObject(gWallBatch, quad, matrix.second);
+		}
+		gStaticGeometry.addObject(gFloorBatch, quad, gModelMatrix["Floor"]);
+		gStaticGeometry.addObject(gCrateBatch, cube, gModelMatrix["Crate"]);
+
+		gStaticGeometry.create();
+		gStaticGeometry.setCulling(StaticGeometry::isCullingSupported());
+		gIndirectDraw = true;
+	}
 
 	float lineVertices[] = {
 		// lines
@@ -247,7 +385,7 @@ void SceneBasic_Uniform::initScene(GLFWwindow* inWindow)
 
 	// create VAO, specify VBO data and format of the data
 	glGenVertexArrays(1, &lineVAO);			// generate unused VAO identifier
-	glBindVertexArray(lineVAO);				// create VAO
+	GLState::bindVertexArray(lineVAO);				// create VAO
 
 	// create VBO
 	glGenBuffers(1, &lineVBO);					// generate unused VBO identifier
@@ -263,13 +401,23 @@ void SceneBasic_Uniform::initScene(GLFWwindow* inWindow)
 	glEnableVertexAttribArray(1);
 }
 
+void ShaderUniforms::resolve(GLSLProgram& shader)
+{
+	// uniforms that a program does not use resolve to location -1 and are ignored
+	// light, material and camera data live in uniform blocks
+	textureSampler = shader.getUniformHandle("uTextureSampler");
+	normalSampler = shader.getUniformHandle("uNormalSampler");
+	environmentMap = shader.getUniformHandle("uEnvironmentMap");
+	cubemapBlendFactor = shader.getUniformHandle("cubemapBlendFactor");
+	environmentLod = shader.getUniformHandle("uEnvironmentLod");
+}
+
 void SceneBasic_Uniform::compile()
 {
 	try {
-		prog.compileShader("shader/basic_uniform.vert");
-		prog.compileShader("shader/basic_uniform.frag");
+		loadShader(prog, "shader/basic_uniform.vert");
+		loadShader(prog, "shader/basic_uniform.frag");
 		prog.link();
-		prog.use();
 	} catch (GLSLProgramException &e) {
 		cerr << e.what() << endl;
 		exit(EXIT_FAILURE);
@@ -298,11 +446,117 @@ void SceneBasic_Uniform::updateLigthPosition()
 	gLight.pos.z = radius * glm::sin(angle);
 }
 
-void SceneBasic_Uniform::updateFPS()
+void SceneBasic_Uniform::updateSceneLights(float t)
 {
-	float currentFrame = glfwGetTime();
-	frameTime = currentFrame - lastFrame;
-	lastFrame = currentFrame;
+	gSceneLights.resize(1 + gNumDynamicLights);
+	gSceneLights[0] = gLight;
+
+	// orbits and colours spread by irrational multiples of the index so no two lights coincide
+	for (int i = 0; i < gNumDynamicLights; i++)
+	{
+		float a = glm::fract(i * 0.618034f);
+		float b = glm::fract(i * 0.754878f);
+		float c = glm::fract(i * 0.569840f);
+
+		float angle = i * 2.399963f + t * (0.2f + 0.6f * b) * (i % 2 == 0 ? 1.0f : -1.0f);
+		float radius = 0.3f + 2.5f * a;
+
+		Light& light = gSceneLights[1 + i];
+		light.pos = glm::vec3(radius * glm::cos(angle), -0.3f + 2.8f * c, radius * glm::sin(angle));
+		light.dir = glm::vec3(0.0f);
+		light.La = glm::vec3(0.0f);
+		light.Ld = 0.4f * glm::clamp(glm::abs(glm::fract(a + glm::vec3(0.0f, 2.0f, 1.0f) / 3.0f) * 6.0f - 3.0f) - 1.0f, 0.0f, 1.0f);
+		light.Ls = light.Ld;
+		light.att = glm::vec3(1.0f, 0.0f, 40.0f);
+		light.innerAngle = 0.0f;
+		light.outerAngle = 0.0f;
+		light.type = 1;
+	}
+}
+
+LightingPrograms SceneBasic_Uniform::registerLightingPrograms(uint32_t lighting, bool indirect)
+{
+	LightingPrograms programs;
+	programs.normalMap = gRenderQueue.registerProgram(
+		gLightingVariants.get(LIGHTING_TEXTURE | LIGHTING_NORMAL_MAP | LIGHTING_INSTANCED | lighting));
+	programs.basicLighting = gRenderQueue.registerProgram(gLightingVariants.get(LIGHTING_TEXTURE | lighting));
+	if (indirect)
+	{
+		programs.staticNormalMap = gRenderQueue.registerProgram(
+			gLightingVariants.get(LIGHTING_TEXTURE | LIGHTING_NORMAL_MAP | LIGHTING_INDIRECT | lighting));
+		programs.staticBasicLighting = gRenderQueue.registerProgram(
+			gLightingVariants.get(LIGHTING_TEXTURE | LIGHTING_INDIRECT | lighting));
+	}
+	return programs;
+}
+
+LightingPrograms SceneBasic_Uniform::registerShadowPrograms(bool indirect)
+{
+	LightingPrograms programs;
+	programs.normalMap = gRenderQueue.registerProgram(gLightingVariants.get(LIGHTING_DEPTH_ONLY | LIGHTING_INSTANCED), false);
+	programs.basicLighting = gRenderQueue.registerProgram(gLightingVariants.get(LIGHTING_DEPTH_ONLY), false);
+	programs.cubemap = programs.basicLighting;
+	if (indirect)
+	{
+		programs.staticNormalMap = gRenderQueue.registerProgram(gLightingVariants.get(LIGHTING_DEPTH_ONLY | LIGHTING_INDIRECT), false);
+		programs.staticBasicLighting = programs.staticNormalMap;
+	}
+	return programs;
+}
+
+LightingPrograms SceneBasic_Uniform::registerPointShadowPrograms(bool indirect)
+{
+	LightingPrograms programs;
+	programs.normalMap = gRenderQueue.registerProgram(
+		gLightingVariants.get(LIGHTING_DEPTH_ONLY | LIGHTING_LAYERED | LIGHTING_INSTANCED), false);
+	programs.basicLighting = gRenderQueue.registerProgram(gLightingVariants.get(LIGHTING_DEPTH_ONLY | LIGHTING_LAYERED), false);
+	programs.cubemap = programs.basicLighting;
+	if (indirect)
+	{
+		programs.staticNormalMap = gRenderQueue.registerProgram(
+			gLightingVariants.get(LIGHTING_DEPTH_ONLY | LIGHTING_LAYERED | LIGHTING_INDIRECT), false);
+		programs.staticBasicLighting = programs.staticNormalMap;
+	}
+	return programs;
+}
+
+void SceneBasic_Uniform::updateFPS(float t)
+{
+	// time comes from the runner so benchmark runs can use a fixed step
+	frameTime = t - lastFrame;
+	lastFrame = t;
+}
+
+void SceneBasic_Uniform::benchmarkUniforms()
+{
+	const int iterations = 100000;
+
+	gNormalMapShader->use();
+
+	// string path: std::string construction and map lookup per call
+	glFinish();
+	double start = glfwGetTime();
+	for (int i = 0; i < iterations; i++)
+		gNormalMapShader->setUniform("uTextureSampler", 0);
+	glFinish();
+	double stringTime = glfwGetTime() - start;
+
+	// hashed path: name hashed at compile time, integer lookup per call
+	start = glfwGetTime();
+	for (int i = 0; i < iterations; i++)
+		gNormalMapShader->setUniform(UNIFORM_NAME("uTextureSampler"), 0);
+	glFinish();
+	double hashedTime = glfwGetTime() - start;
+
+	// handle path: location resolved once after linking
+	start = glfwGetTime();
+	for (int i = 0; i < iterations; i++)
+		gNormalMapShader->setUniform(gNormalMapUniforms.textureSampler, 0);
+	glFinish();
+	double handleTime = glfwGetTime() - start;
+
+	printf("setUniform x %d: string %.3f ms, hashed %.3f ms, handle %.3f ms\n", iterations,
+		stringTime * 1000.0, hashedTime * 1000.0, handleTime * 1000.0);
 }
 
 void SceneBasic_Uniform::update( float t )
@@ -329,177 +583,357 @@ void SceneBasic_Uniform::update( float t )
 		updateLigthPosition();
 	}
 
-	updateFPS();
+	if (gClusteredLighting)
+	{
+		updateSceneLights(t);
+	}
+
+	updateFPS(t);
 }
 
-void SceneBasic_Uniform::drawWall(const glm::mat4& modelMatrix, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, Texture& texture, Texture& normalMap)
+std::vector<GLSLProgram*> SceneBasic_Uniform::getWatchedPrograms()
 {
-	// calculate matrices
-	glm::mat4 MVP = projectionMatrix * viewMatrix * modelMatrix;
-	glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(modelMatrix)));
-
-	// set uniform variables
-	gNormalMapShader.setUniform("uModelViewProjectionMatrix", MVP);
-	gNormalMapShader.setUniform("uModelMatrix", modelMatrix);
-	gNormalMapShader.setUniform("uNormalMatrix", normalMatrix);
+	std::vector<GLSLProgram*> programs = { &gColorShader, &gCullShader, &gPyramidFromDepthShader, &gPyramidReduceShader,
+		&gLightClusterShader, &gPrefilterShader };
+	for (const auto& variant : gLightingVariants.getVariants())
+		programs.push_back(variant.second.get());
+	return programs;
+}
 
-	// set texture and normal map
-	gNormalMapShader.setUniform("uTextureSampler", 0);
-	gNormalMapShader.setUniform("uNormalSampler", 1);
+void SceneBasic_Uniform::reloadShaders()
+{
+	std::vector<GLSLProgram*> programs = getWatchedPrograms();
 
-	glActiveTexture(GL_TEXTURE0);
-	texture.bind();
+	// start compiling every program that uses a changed file, the old ones keep drawing meanwhile
+	std::vector<std::string> changed = gShaderWatcher.poll();
+	for (GLSLProgram* program : programs)
+	{
+		for (const std::string& file : changed)
+		{
+			if (program->usesFile(file))
+			{
+				std::cout << "Reloading " << file << std::endl;
+				program->reload();
+				break;
+			}
+		}
+	}
 
-	glActiveTexture(GL_TEXTURE1);
-	normalMap.bind();
+	// uniform handles survive the swap, sampler units are set again
+	for (GLSLProgram* program : programs)
+	{
+		if (program->updateReload())
+			gRenderQueue.reloadProgram(*program);
+	}
+}
 
-	glBindVertexArray(gVAO);				// make VAO active
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);	// render the vertices
+void SceneBasic_Uniform::loadShader(GLSLProgram& shader, const char* fileName)
+{
+	const AssetEntry* entry = gArchive.isOpen() ? gArchive.find(fileName) : nullptr;
+	if (entry && entry->type == ASSET_SHADER)
+		shader.compileShaderFromMemory(reinterpret_cast<const char*>(gArchive.getData(*entry)), entry->size, fileName);
+	else
+		shader.compileShader(fileName);
 }
 
-void SceneBasic_Uniform::drawModel(GLSLProgram& shader, SimpleModel& model, const glm::mat4& modelMatrix, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, Texture& texture, Texture& normalMap)
+void SceneBasic_Uniform::loadModel(SimpleModel& model, const char* fileName, bool texture)
 {
-	// calculate matrices
-	glm::mat4 MVP = projectionMatrix * viewMatrix * modelMatrix;
-	glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(modelMatrix)));
+	// the archive entry must have been cooked with the same vertex format
+	const AssetEntry* entry = gArchive.isOpen() ? gArchive.find(fileName) : nullptr;
+	if (entry && entry->type == ASSET_MESH && entry->param == (texture ? 1u : 0u) &&
+		model.loadCooked(gArchive.getData(*entry), entry->size, texture))
+		return;
 
-	// set uniform variables
-	shader.setUniform("uModelViewProjectionMatrix", MVP);
-	shader.setUniform("uModelMatrix", modelMatrix);
-	shader.setUniform("uNormalMatrix", normalMatrix);
+	model.loadModel(fileName, texture);
+}
 
-	// set texture and normal map
-	shader.setUniform("uTextureSampler", 0);
-	shader.setUniform("uNormalSampler", 1);
+void SceneBasic_Uniform::loadTexture(Texture& texture, const char* fileName, TextureCompression compression)
+{
+	// the archive outlives the streamer, so its data can be read in place
+	const AssetEntry* entry = gArchive.isOpen() ? gArchive.find(fileName) : nullptr;
+	if (entry && entry->type == ASSET_TEXTURE && entry->param == static_cast<uint32_t>(compression))
+		gTextureStreamer.requestCooked(texture, fileName, gArchive.getData(*entry), entry->size, compression);
+	else
+		gTextureStreamer.request(texture, fileName, compression);
+}
 
-	glActiveTexture(GL_TEXTURE0);
-	texture.bind();
+void SceneBasic_Uniform::drawQuads(int program, InstancedQuad& quads, Texture& texture, Texture& normalMap, const char* scope)
+{
+	// model and normal matrices are per-instance attributes, view-projection comes from the frame block
+	// nothing is submitted when every instance is outside the frustum
+	if (quads.cull(gFrustum) == 0)
+		return;
 
-	glActiveTexture(GL_TEXTURE1);
-	normalMap.bind();
+	DrawItem item;
+	item.program = program;
+	item.material = gDefaultMaterial;
+	item.textures[0] = &texture;
+	item.textures[1] = &normalMap;
+	item.quads = &quads;
+	item.scope = scope;
 
-	model.drawModel();
+	gRenderQueue.submit(item);
 }
 
-void SceneBasic_Uniform::render_scene(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
+void SceneBasic_Uniform::drawModel(int program, SimpleModel& model, const glm::mat4& modelMatrix, Texture& texture, Texture& normalMap, const char* scope)
 {
-	// Ⱦ
-	// use the shaders associated with the shader program
-	gNormalMapShader.use();
+	// reject off-screen models before any matrices are calculated
+	BoundingBox bounds = model.getBounds().transformed(modelMatrix);
+	if (!gFrustum.testBox(bounds))
+		return;
 
-	// set light properties
-	gNormalMapShader.setUniform("uLight.pos", gLight.pos);
-	gNormalMapShader.setUniform("uLight.La", gLight.La);
-	gNormalMapShader.setUniform("uLight.Ld", gLight.Ld);
-	gNormalMapShader.setUniform("uLight.Ls", gLight.Ls);
-	gNormalMapShader.setUniform("uLight.att", gLight.att);
+	// in a layered pass the model only goes to the cube faces it touches
+	int layerMask = 0x3F;
+	if (gLayerFrusta)
+	{
+		layerMask = 0;
+		for (int face = 0; face < PointShadow::NUM_FACES; face++)
+		{
+			if (gLayerFrusta[face].testBox(bounds))
+				layerMask |= 1 << face;
+		}
+		if (layerMask == 0)
+			return;
+	}
 
-	// set material properties
-	gNormalMapShader.setUniform("uMaterial.Ka", gMaterial.Ka);
-	gNormalMapShader.setUniform("uMaterial.Kd", gMaterial.Kd);
-	gNormalMapShader.setUniform("uMaterial.Ks", gMaterial.Ks);
-	gNormalMapShader.setUniform("uMaterial.shininess", gMaterial.shininess);
+	// matrices are calculated by the render queue when the item is drawn
+	DrawItem item;
+	item.program = program;
+	item.material = gDefaultMaterial;
+	item.textures[0] = &texture;
+	item.textures[1] = &normalMap;
+	item.model = &model;
+	item.hasModelMatrix = true;
+	item.modelMatrix = modelMatrix;
+	item.layerMask = layerMask;
+	item.scope = scope;
+
+	gRenderQueue.submit(item);
+}
 
-	// set viewing position
-	gNormalMapShader.setUniform("uViewpoint", glm::vec3(0.0f, 0.0f, 4.0f));
+void SceneBasic_Uniform::drawStatic(int program, int batch, Texture& texture, Texture& normalMap, const char* scope)
+{
+	// matrices are already in the per-draw buffer; one call however many objects the batch
+	// holds, drawing only the commands the last cull() kept when GPU culling is on
+	DrawItem item;
+	item.program = program;
+	item.material = gDefaultMaterial;
+	item.textures[0] = &texture;
+	item.textures[1] = &normalMap;
+	item.geometry = &gStaticGeometry;
+	item.batch = batch;
+	item.scope = scope;
+
+	gRenderQueue.submit(item);
+}
 
+void SceneBasic_Uniform::updateFrameBlock(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
+{
+	// camera and light data for every program in one buffer update
+	FrameBlock frame;
+	frame.viewMatrix = viewMatrix;
+	frame.projectionMatrix = projectionMatrix;
+	frame.viewProjectionMatrix = projectionMatrix * viewMatrix;
+	frame.viewpoint = glm::vec3(0.0f, 0.0f, 4.0f);
+	frame.pad0 = 0.0f;
+	frame.light = gLight.toBlock();
+	gFrameBuffer.update(&frame, sizeof(frame));
+
+	gFrustum.extract(frame.viewProjectionMatrix);
+}
+
+void SceneBasic_Uniform::submitScene(const LightingPrograms& programs, int objects)
+{
 	Texture& floorTexture = gTexture["White"];
 	Texture& floorNormalMap = gTexture["WhiteNormalMap"];
 
 	Texture& wallTexture = gTexture["Stone"];
 	Texture& wallNormalMap = gTexture["StoneNormalMap"];
 
-	drawWall(gModelMatrix["BackWall1"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["BackWall2"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["BackWall3"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["BackWall4"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["BackWall5"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["BackWall6"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-
-	drawWall(gModelMatrix["FrontWall1"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["FrontWall2"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["FrontWall3"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["FrontWall4"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["FrontWall5"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["FrontWall6"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-
-	drawWall(gModelMatrix["LeftWall1"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["LeftWall2"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["LeftWall3"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["LeftWall4"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["LeftWall5"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["LeftWall6"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-
-	drawWall(gModelMatrix["RightWall1"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["RightWall2"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["RightWall3"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["RightWall4"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["RightWall5"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-	drawWall(gModelMatrix["RightWall6"], viewMatrix, projectionMatrix, wallTexture, wallNormalMap);
-
-	// use the shaders associated with the shader program
-	gBasicLightingShader.use();
-
-	// set light properties
-	gBasicLightingShader.setUniform("uLight.pos", gLight.pos);
-	gBasicLightingShader.setUniform("uLight.La", gLight.La);
-	gBasicLightingShader.setUniform("uLight.Ld", gLight.Ld);
-	gBasicLightingShader.setUniform("uLight.Ls", gLight.Ls);
-	gBasicLightingShader.setUniform("uLight.att", gLight.att);
-
-	// set material properties
-	gBasicLightingShader.setUniform("uMaterial.Ka", gMaterial.Ka);
-	gBasicLightingShader.setUniform("uMaterial.Kd", gMaterial.Kd);
-	gBasicLightingShader.setUniform("uMaterial.Ks", gMaterial.Ks);
-	gBasicLightingShader.setUniform("uMaterial.shininess", gMaterial.shininess);
-
-	// set viewing position
-	gBasicLightingShader.setUniform("uViewpoint", glm::vec3(0.0f, 0.0f, 4.0f));
-
-	auto modelMatrix = glm::translate(glm::vec3(1.0f, 1.0f, 1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
-
 	Texture& crateTexture = gTexture["Crate"];
 
-	drawModel(gBasicLightingShader, gCubeModel, modelMatrix, viewMatrix, projectionMatrix, crateTexture, crateTexture);
+	if (objects & SCENE_OPAQUE)
+	{
+		if (gIndirectDraw)
+		{
+			drawStatic(programs.staticNormalMap, gWallBatch, wallTexture, wallNormalMap, "walls");
+			drawStatic(programs.staticBasicLighting, gCrateBatch, crateTexture, crateTexture, "models");
+			drawStatic(programs.staticNormalMap, gFloorBatch, floorTexture, floorNormalMap, "floor");
+		}
+		else
+		{
+			drawQuads(programs.normalMap, gWallQuads, wallTexture, wallNormalMap, "walls");
+			drawModel(programs.basicLighting, gCubeModel, gModelMatrix["Crate"], crateTexture, crateTexture, "models");
+			// Ƶذ
+			drawQuads(programs.normalMap, gFloorQuads, floorTexture, floorNormalMap, "floor");
+		}
+	}
 
-	// use the shaders associated with the shader program
-	gCubemapShader.use();
+	if ((objects & SCENE_REFLECTORS) == 0)
+		return;
 
-	// set light properties
-	gCubemapShader.setUniform("uLight.dir", gLight.dir);
+	auto modelMatrix = glm::translate(glm::vec3(-1.0f, 1.0f, -1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.8f));
 
-	gCubemapShader.setUniform("uLight.La", gLight.La);
-	gCubemapShader.setUniform("uLight.Ld", gLight.Ld);
-	gCubemapShader.setUniform("uLight.Ls", gLight.Ls);
-	gCubemapShader.setUniform("uLight.att", gLight.att);
+	auto rotation = glm::rotate(glm::radians(rotateAngle), glm::vec3(1.0f, 0.0f, 0.0f));
 
-	// set material properties
-	gCubemapShader.setUniform("uMaterial.Ka", gMaterial.Ka);
-	gCubemapShader.setUniform("uMaterial.Kd", gMaterial.Kd);
-	gCubemapShader.setUniform("uMaterial.Ks", gMaterial.Ks);
-	gCubemapShader.setUniform("uMaterial.shininess", gMaterial.shininess);
+	modelMatrix *= rotation;
 
-	// set viewing position
-	gCubemapShader.setUniform("uViewpoint", glm::vec3(0.0f, 0.0f, 4.0f));
+	// render model
+	Texture& environmentMap = (gDynamicReflections && gReflectionProbe.isCreated()) ? gReflectionProbe.getTexture() : gCubeEnvMap;
+	drawModel(programs.cubemap, gTorusModel, modelMatrix, environmentMap, environmentMap, "torus");
+}
 
-	// set cube environment map
-	gCubemapShader.setUniform("uEnvironmentMap", 0);
+void SceneBasic_Uniform::render_shadows()
+{
+	if (!gShadowCascades.isCreated())
+		return;
 
-	modelMatrix = glm::translate(glm::vec3(-1.0f, 1.0f, -1.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.8f));
+	GpuScope scope(gProfiler, "shadows");
+	gShadowCascades.update(mainCamera.GetViewMatrix(), gProjectionMatrix, gLight.dir);
 
-	auto rotation = glm::rotate(glm::radians(rotateAngle), glm::vec3(1.0f, 0.0f, 0.0f));
+	// the same batches as the main pass, each cascade culled against its own light volume
+	for (int cascade = 0; cascade < gShadowCascades.numCascades(); cascade++)
+	{
+		const glm::mat4& viewMatrix = gShadowCascades.getViewMatrix(cascade);
+		const glm::mat4& projectionMatrix = gShadowCascades.getProjectionMatrix(cascade);
 
-	modelMatrix *= rotation;
+		gShadowCascades.beginCascade(cascade);
+		updateFrameBlock(viewMatrix, projectionMatrix);
 
-	gCubemapShader.setUniform("cubemapBlendFactor", cubemapBlendFactor);
+		// the depth pyramid holds the camera's occluders, not the light's
+		if (gIndirectDraw && gStaticGeometry.isCulling())
+			gStaticGeometry.cull(gCullShader, gFrustum, nullptr);
 
-	// render model
-	drawModel(gCubemapShader, gTorusModel, modelMatrix, viewMatrix, projectionMatrix, gCubeEnvMap, gCubeEnvMap);
+		gRenderQueue.begin(viewMatrix, projectionMatrix);
+		submitScene(gShadowPrograms);
+		gRenderQueue.flush();
+	}
+
+	gShadowCascades.end(gTargetFramebuffer);
+}
+
+void SceneBasic_Uniform::render_point_shadows()
+{
+	if (!gPointShadow.isCreated())
+		return;
+
+	GpuScope scope(gProfiler, "point shadows");
+	gPointShadow.update(gLight.pos);
+	gPointShadow.begin();
+
+	// everything within the light's range goes through once, the geometry shader picks the faces
+	updateFrameBlock(gPointShadow.getRangeViewMatrix(), gPointShadow.getRangeProjectionMatrix());
+	gLayerFrusta = &gPointShadow.getFaceFrustum(0);
+
+	if (gIndirectDraw && gStaticGeometry.isCulling())
+		gStaticGeometry.cull(gCullShader, gFrustum, nullptr);
+
+	gRenderQueue.begin(gPointShadow.getRangeViewMatrix(), gPointShadow.getRangeProjectionMatrix());
+	submitScene(gPointShadowPrograms);
+	gRenderQueue.flush();
+
+	gLayerFrusta = nullptr;
+	gPointShadow.end(gTargetFramebuffer);
+}
+
+void SceneBasic_Uniform::render_probe()
+{
+	if (!gDynamicReflections || !gReflectionProbe.isCreated())
+		return;
+
+	// as many faces as the probe's budget allows, judged by what earlier updates cost
+	int faces = gReflectionProbe.schedule(gProfiler.getAverage("reflection probe"));
+	if (faces == 0)
+		return;
+
+	GpuScope scope(gProfiler, "reflection probe");
+
+	// the capture is lit like the main pass on the single light path
+	if (gShadowCascades.isCreated())
+		gShadowCascades.bind(RenderQueue::SHADOW_MAP_UNIT);
+	if (gPointShadow.isCreated())
+		gPointShadow.bind(RenderQueue::POINT_SHADOW_MAP_UNIT);
+
+	for (int i = 0; i < faces; i++)
+	{
+		int face = gReflectionProbe.beginFace();
+		glm::mat4 viewMatrix = gReflectionProbe.getViewMatrix(face);
+		const glm::mat4& projectionMatrix = gReflectionProbe.getProjectionMatrix();
+		updateFrameBlock(viewMatrix, projectionMatrix);
+
+		if (gIndirectDraw && gStaticGeometry.isCulling())
+			gStaticGeometry.cull(gCullShader, gFrustum, nullptr);
+
+		gRenderQueue.begin(viewMatrix, projectionMatrix);
+		submitScene(gForwardPrograms, SCENE_OPAQUE);
+		gRenderQueue.flush();
+	}
+
+	gReflectionProbe.prefilter(gPrefilterShader);
+	gReflectionProbe.end(gTargetFramebuffer);
+}
+
+void SceneBasic_Uniform::render_scene(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
+{
+	// Ⱦ
+	updateFrameBlock(viewMatrix, projectionMatrix);
+
+	// static objects are culled on the GPU, the CPU never sees which ones are visible
+	if (gIndirectDraw && gStaticGeometry.isCulling())
+	{
+		GpuScope scope(gProfiler, "cull");
+		gStaticGeometry.cull(gCullShader, gFrustum, &gDepthPyramid);
+	}
+
+	// lights are binned before any draw reads the clusters
+	if (gClusteredLighting)
+	{
+		GpuScope scope(gProfiler, "light clusters");
+		gLightClusters.update(gSceneLights, projectionMatrix, width, height);
+		gLightClusters.build(gLightClusterShader);
+	}
+
+	// cubemap blend is per-frame state rather than per-draw
+	gCubemapShader->use();
+	gCubemapShader->setUniform(gCubemapUniforms.cubemapBlendFactor, cubemapBlendFactor);
+	float environmentLevels = gDynamicReflections ? static_cast<float>(gReflectionProbe.numLevels() - 1) : 0.0f;
+	gCubemapShader->setUniform(gCubemapUniforms.environmentLod, gReflectionRoughness * environmentLevels);
 
-	// Ƶذ
-	gNormalMapShader.use();
+	// shadow maps stay bound above the per-item texture units
+	if (gShadowCascades.isCreated())
+		gShadowCascades.bind(RenderQueue::SHADOW_MAP_UNIT);
+	if (gPointShadow.isCreated())
+		gPointShadow.bind(RenderQueue::POINT_SHADOW_MAP_UNIT);
 
-	drawWall(gModelMatrix["Floor"], viewMatrix, projectionMatrix, floorTexture, floorNormalMap);
+	const LightingPrograms& programs = gClusteredLighting ? gClusteredPrograms : gForwardPrograms;
+	if (gDeferredShading && gDeferredTargetSupported)
+	{
+		// opaque objects are shaded once per pixel, however many of their fragments were drawn
+		{
+			GpuScope scope(gProfiler, "g-buffer");
+			gGBuffer.begin(width, height);
+			gRenderQueue.begin(viewMatrix, projectionMatrix);
+			submitScene(gGBufferPrograms, SCENE_OPAQUE);
+			gRenderQueue.flush(&gProfiler);
+		}
+		{
+			GpuScope scope(gProfiler, "deferred lighting");
+			gGBuffer.resolve(gClusteredLighting ? *gDeferredClusteredShader : *gDeferredShader, projectionMatrix * viewMatrix,
+				gTargetFramebuffer);
+		}
+
+		// the G-buffer has no room for the environment map, so reflectors stay forward, tested against its depth
+		gRenderQueue.begin(viewMatrix, projectionMatrix);
+		submitScene(programs, SCENE_REFLECTORS);
+		gRenderQueue.flush(&gProfiler);
+	}
+	else
+	{
+		// draws are collected here and issued in state order by flush()
+		gRenderQueue.begin(viewMatrix, projectionMatrix);
+		submitScene(programs);
+		gRenderQueue.flush(&gProfiler);
+	}
 
 	// flush the graphics pipeline
 	glFlush();
@@ -558,6 +992,82 @@ void SceneBasic_Uniform::key_callback(GLFWwindow* window, int key, int scancode,
 		}
 	}
 
+	if (key == GLFW_KEY_P && action == GLFW_PRESS)
+	{
+		app->gProfiler.print();
+		GLState::print();
+		printf("visible quads: walls %d/%d, floor %d/%d\n", app->gWallQuads.numVisible(), app->gWallQuads.numInstances(),
+			app->gFloorQuads.numVisible(), app->gFloorQuads.numInstances());
+	}
+
+	if (key == GLFW_KEY_I && action == GLFW_PRESS && app->gStaticGeometry.isCreated())
+	{
+		app->gIndirectDraw = !app->gIndirectDraw;
+		printf("static geometry: %s\n", app->gIndirectDraw ? "multi-draw indirect" : "per-object draws");
+	}
+
+	if (key == GLFW_KEY_G && action == GLFW_PRESS && app->gStaticGeometry.isCreated() && StaticGeometry::isCullingSupported())
+	{
+		app->gStaticGeometry.setCulling(!app->gStaticGeometry.isCulling());
+		printf("GPU culling: %s\n", app->gStaticGeometry.isCulling() ? "on" : "off");
+	}
+
+	if (key == GLFW_KEY_L && action == GLFW_PRESS && app->gLightClusters.isCreated())
+	{
+		app->gClusteredLighting = !app->gClusteredLighting;
+		if (app->gClusteredLighting)
+			app->updateSceneLights(app->lastFrame);
+		printf("lighting: %s\n", app->gClusteredLighting ? "clustered" : "single light");
+	}
+
+	if (key == GLFW_KEY_C && action == GLFW_PRESS && app->gShadowCascades.isCreated())
+	{
+		int cascades = app->gShadowCascades.numCascades() % MAX_SHADOW_CASCADES + 1;
+		app->gShadowCascades.create(cascades, app->gShadowCascades.getResolution());
+		printf("shadow cascades: %d x %d\n", cascades, app->gShadowCascades.getResolution());
+	}
+
+	if (key == GLFW_KEY_V && action == GLFW_PRESS && app->gShadowCascades.isCreated())
+	{
+		int resolution = app->gShadowCascades.getResolution() >= 4096 ? 512 : app->gShadowCascades.getResolution() * 2;
+		app->gShadowCascades.create(app->gShadowCascades.numCascades(), resolution);
+		printf("shadow cascades: %d x %d\n", app->gShadowCascades.numCascades(), resolution);
+	}
+
+	if (key == GLFW_KEY_B && action == GLFW_PRESS && app->gPointShadow.isCreated())
+	{
+		int resolution = app->gPointShadow.getResolution() >= 2048 ? 256 : app->gPointShadow.getResolution() * 2;
+		app->gPointShadow.create(resolution);
+		printf("point shadow faces: %d x %d\n", resolution, resolution);
+	}
+
+	if (key == GLFW_KEY_F && action == GLFW_PRESS && app->gDeferredShader)
+	{
+		app->gDeferredShading = !app->gDeferredShading;
+		if (app->gDeferredShading && !app->gDeferredTargetSupported)
+			printf("shading: forward, the target framebuffer is multisampled\n");
+		else
+			printf("shading: %s\n", app->gDeferredShading ? "deferred" : "forward");
+	}
+
+	if (key == GLFW_KEY_R && action == GLFW_PRESS && app->gReflectionProbe.isCreated())
+	{
+		app->gDynamicReflections = !app->gDynamicReflections;
+		printf("reflections: %s\n", app->gDynamicReflections ? "reflection probe" : "static cube map");
+	}
+
+	if ((key == GLFW_KEY_LEFT_BRACKET || key == GLFW_KEY_RIGHT_BRACKET) && action == GLFW_PRESS)
+	{
+		float step = key == GLFW_KEY_LEFT_BRACKET ? -0.1f : 0.1f;
+		app->gReflectionRoughness = glm::clamp(app->gReflectionRoughness + step, 0.0f, 1.0f);
+		printf("reflection roughness: %.1f\n", app->gReflectionRoughness);
+	}
+
+	if (key == GLFW_KEY_U && action == GLFW_PRESS)
+	{
+		app->benchmarkUniforms();
+	}
+
 	if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
 	{
 		MessageBox(nullptr, L"Space pressed.", L"Message", MB_OK);
@@ -600,13 +1110,55 @@ void SceneBasic_Uniform::mouse_button_callback(GLFWwindow* window, int button, i
 
 void SceneBasic_Uniform::render()
 {
+	// collect GPU timings from earlier frames
+	gProfiler.beginFrame();
+
+	// the runner may have bound an offscreen target, passes rendering elsewhere return to it
+	GLint targetFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFramebuffer);
+	gTargetFramebuffer = static_cast<GLuint>(targetFramebuffer);
+	gDeferredTargetSupported = GBuffer::isSupported();
+
+	// upload streamed textures for a slice of the frame
+	gTextureStreamer.update(2.0);
+
+	// swap in edited shaders before anything is drawn
+	reloadShaders();
+
+	// shadow maps first, they leave the target framebuffer bound
+	render_shadows();
+	render_point_shadows();
+	render_probe();
+
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
 	glViewport(0, 0, width, height);
 
 	render_scene(mainCamera.GetViewMatrix(), gProjectionMatrix);			// render the scene
 
-    glBindVertexArray(0);
+	// this frame's depth holds the occluders for the next cull
+	if (gIndirectDraw && gStaticGeometry.isCulling())
+	{
+		GpuScope scope(gProfiler, "depth pyramid");
+		gDepthPyramid.build(gPyramidFromDepthShader, gPyramidReduceShader, width, height,
+			gProjectionMatrix * mainCamera.GetViewMatrix());
+	}
+	else
+	{
+		gDepthPyramid.invalidate();
+	}
+
+    GLState::bindVertexArray(0);
+}
+
+std::vector<std::pair<std::string, double>> SceneBasic_Uniform::getGpuTimings()
+{
+	return gProfiler.getAverages();
+}
+
+bool SceneBasic_Uniform::isLoading()
+{
+	return gTextureStreamer.numPending() > 0;
 }
 
 void SceneBasic_Uniform::resize(int w, int h)
@@ -8,8 +8,75 @@
 #include "helper/Texture.h"
 #include "helper/Camera.h"
 #include "helper/SimpleModel.h"
+#include "helper/InstancedQuad.h"
+#include "helper/UniformBuffer.h"
+#include "helper/GpuProfiler.h"
+#include "helper/RenderQueue.h"
+#include "helper/GLState.h"
+#include "helper/Frustum.h"
+#include "helper/TextureStreamer.h"
+#include "helper/AssetArchive.h"
+#include "helper/FileWatcher.h"
+#include "helper/ShaderVariants.h"
+#include "helper/StaticGeometry.h"
+#include "helper/DepthPyramid.h"
+#include "helper/LightClusters.h"
+#include "helper/ShadowCascades.h"
+#include "helper/PointShadow.h"
+#include "helper/ReflectionProbe.h"
+#include "helper/GBuffer.h"
 #include <GLFW/glfw3.h>
 
+// uniform handles shared by the lighting shader programs
+// per-object matrices are set by the render queue
+struct ShaderUniforms
+{
+	UniformHandle textureSampler;
+	UniformHandle normalSampler;
+	UniformHandle environmentMap;
+	UniformHandle cubemapBlendFactor;
+	UniformHandle environmentLod;
+
+	void resolve(GLSLProgram& shader);
+};
+
+// features of the shader/phong.* lighting variants, bit order matches the define names
+enum LightingFeature
+{
+	LIGHTING_TEXTURE = 1 << 0,			// colour map
+	LIGHTING_NORMAL_MAP = 1 << 1,		// tangent space normal map
+	LIGHTING_INSTANCED = 1 << 2,		// per-instance matrices
+	LIGHTING_ENV_MAP = 1 << 3,			// cube map reflection
+	LIGHTING_DIRECTIONAL = 1 << 4,		// directional rather than point light
+	LIGHTING_ATTENUATION = 1 << 5,		// point light with linear or quadratic falloff
+	LIGHTING_INDIRECT = 1 << 6,			// per-draw matrices of static geometry
+	LIGHTING_CLUSTERED = 1 << 7,		// every light binned into the fragment's cluster
+	LIGHTING_SHADOWS = 1 << 8,			// directional light shadowed by the shadow cascades
+	LIGHTING_DEPTH_ONLY = 1 << 9,		// shadow map pass
+	LIGHTING_LAYERED = 1 << 10,			// all six cube faces in one pass, through shader/pointShadow.geom
+	LIGHTING_POINT_SHADOWS = 1 << 11,	// point light shadowed by its cube shadow map
+	LIGHTING_GBUFFER = 1 << 12,			// G-buffer pass of the deferred path
+	LIGHTING_DEFERRED = 1 << 13,		// full-screen lighting pass of the deferred path
+};
+
+// object groups of submitScene
+enum SceneObjects
+{
+	SCENE_OPAQUE = 1 << 0,			// walls, floor and crate
+	SCENE_REFLECTORS = 1 << 1,		// environment mapped, so always lit forward
+	SCENE_ALL = SCENE_OPAQUE | SCENE_REFLECTORS,
+};
+
+// render queue program indices of one lighting path
+struct LightingPrograms
+{
+	int normalMap = 0;
+	int basicLighting = 0;
+	int staticNormalMap = 0;
+	int staticBasicLighting = 0;
+	int cubemap = 0;
+};
+
 class SceneBasic_Uniform : public Scene
 {
 private:
@@ -19,14 +86,38 @@ private:
 
 	// frame stats
 	float gFrameRate = 60.0f;
+	GpuProfiler gProfiler;			// per-pass GPU timings
+	RenderQueue gRenderQueue;		// state-sorted draw submission
+	LightingPrograms gForwardPrograms;		// single light
+	LightingPrograms gClusteredPrograms;	// every light in the fragment's cluster
+	LightingPrograms gShadowPrograms;		// depth only
+	LightingPrograms gPointShadowPrograms;	// depth only, layered over the cube faces
+	LightingPrograms gGBufferPrograms;		// G-buffer writes of the deferred path
+	int gCubemapProgram = 0;		// render queue program index
+	int gDefaultMaterial = 0;		// render queue material index
+	Frustum gFrustum;				// view frustum of the current render_scene call
+	GLuint gTargetFramebuffer = 0;	// framebuffer bound by the caller of render()
+	bool gDeferredTargetSupported = false;	// the target can take the G-buffer's depth
+	const Frustum* gLayerFrusta = nullptr;	// per-face frusta of a layered pass, null otherwise
 
 	// scene content
-	GLSLProgram gNormalMapShader;	// shader program object
-	GLSLProgram gBasicLightingShader;	// shader program object
-	GLSLProgram gCubemapShader;
+	AssetArchive gArchive;			// cooked assets, declared before the streamer so it outlives its jobs
+	ShaderVariants gLightingVariants;	// lighting programs by feature mask
+	GLSLProgram* gNormalMapShader = nullptr;	// variants used by the scene
+	GLSLProgram* gBasicLightingShader = nullptr;
+	GLSLProgram* gCubemapShader = nullptr;
+	GLSLProgram* gDeferredShader = nullptr;				// lighting passes of the deferred path
+	GLSLProgram* gDeferredClusteredShader = nullptr;
 	GLSLProgram gColorShader;
-	GLuint gVBO = 0;		// vertex buffer object identifier
-	GLuint gVAO = 0;		// vertex array object identifier
+	GLSLProgram gCullShader;				// static geometry culling
+	GLSLProgram gPyramidFromDepthShader;	// depth pyramid level 0
+	GLSLProgram gPyramidReduceShader;		// depth pyramid further levels
+	GLSLProgram gLightClusterShader;		// light binning
+	GLSLProgram gPrefilterShader;			// reflection probe mip chain
+	ShaderUniforms gNormalMapUniforms;
+	ShaderUniforms gBasicLightingUniforms;
+	ShaderUniforms gCubemapUniforms;
+	FileWatcher gShaderWatcher;		// shader sources, for reloading on save
 	GLuint lineVAO = 0;
 	GLuint lineVBO = 0;
 
@@ -37,13 +128,26 @@ private:
 	glm::mat4 gOrthoMatrix;
 
 	Light gLight;					// light properties
+	std::vector<Light> gSceneLights;	// gLight and the dynamic lights, for the clustered path
+	int gNumDynamicLights = 256;
+	LightClusters gLightClusters;	// lights binned per view space cluster
+	ShadowCascades gShadowCascades;	// shadow maps of the directional light
+	PointShadow gPointShadow;		// cube shadow map of the point light
 	Material gMaterial;				// material properties
+	UniformBuffer gFrameBuffer;		// per-frame camera and light block
+	UniformBuffer gMaterialBuffer;	// material block
 	std::map<std::string, Texture> gTexture;	// texture objects
+	TextureStreamer gTextureStreamer;			// background texture loading
 
 	float rotateAngle = 0.0f;
 
 	// controls
 	bool gWireframe = false;	// wireframe control
+	bool gIndirectDraw = false;	// static geometry through multi-draw indirect
+	bool gClusteredLighting = false;	// dynamic lights through the light clusters
+	bool gDynamicReflections = true;	// torus reflects the reflection probe rather than gCubeEnvMap
+	float gReflectionRoughness = 0.0f;	// 0 mirror, 1 the probe's blurriest level
+	bool gDeferredShading = false;	// opaque objects through the G-buffer rather than forward
 
 	bool enableMultipleViews = false;
 
@@ -53,7 +157,18 @@ private:
 	SimpleModel gTorusModel;		// scene object model
 	SimpleModel gCubeModel;		// scene object model
 
+	InstancedQuad gWallQuads;		// wall instances
+	InstancedQuad gFloorQuads;		// floor instances
+
+	StaticGeometry gStaticGeometry;	// walls, floor and crate in merged buffers
+	int gWallBatch = 0;				// static geometry batch indices
+	int gFloorBatch = 0;
+	int gCrateBatch = 0;
+	DepthPyramid gDepthPyramid;		// last frame's depth, occluders for the cull pass
+
 	Texture gCubeEnvMap;			// cube environment map
+	ReflectionProbe gReflectionProbe;	// the scene around the torus, captured at run time
+	GBuffer gGBuffer;				// deferred path targets
 
 	GLFWwindow* window;
 
@@ -78,11 +193,41 @@ private:
 
 	void updateLigthPosition();
 
-	void updateFPS();
+	// gLight followed by small coloured lights orbiting the room
+	void updateSceneLights(float t);
+
+	// register the lighting variants that share the given lighting features
+	LightingPrograms registerLightingPrograms(uint32_t lighting, bool indirect);
+	// register the depth only variants, one per vertex path
+	LightingPrograms registerShadowPrograms(bool indirect);
+	// register the depth only variants that fill every cube face in one pass
+	LightingPrograms registerPointShadowPrograms(bool indirect);
+
+	void updateFPS(float t);
+
+	void benchmarkUniforms();
+
+	// recompile programs whose source files changed and swap them in once ready
+	void reloadShaders();
+	std::vector<GLSLProgram*> getWatchedPrograms();
+
+	// load from the asset archive if it holds the file, otherwise from disk
+	void loadShader(GLSLProgram& shader, const char* fileName);
+	void loadModel(SimpleModel& model, const char* fileName, bool texture);
+	void loadTexture(Texture& texture, const char* fileName, TextureCompression compression);
+
+	void drawQuads(int program, InstancedQuad& quads, Texture& texture, Texture& normalMap, const char* scope);
+	void drawModel(int program, SimpleModel& model, const glm::mat4& modelMatrix, Texture& texture, Texture& normalMap, const char* scope);
+	void drawStatic(int program, int batch, Texture& texture, Texture& normalMap, const char* scope);
 
-	void drawWall(const glm::mat4& modelMatrix, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, Texture& texture, Texture& normalMap);
-	void drawModel(GLSLProgram& shader, SimpleModel& model, const glm::mat4& modelMatrix, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, Texture& texture, Texture& normalMap);
+	// upload the frame block for a view and extract gFrustum from it
+	void updateFrameBlock(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+	// submit the objects of the given SceneObjects groups to the render queue, culled against gFrustum
+	void submitScene(const LightingPrograms& programs, int objects = SCENE_ALL);
 
+	void render_shadows();
+	void render_point_shadows();
+	void render_probe();
 	void render_scene(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
 
 	static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -95,6 +240,8 @@ public:
     void update( float t );
     void render();
     void resize(int, int);
+    std::vector<std::pair<std::string, double>> getGpuTimings();
+    bool isLoading();
 };
 
 #endif // SCENEBASIC_UNIFORM_H
@@ -0,0 +1,53 @@
+#version 410 core
+
+// one face of one mip level of a reflection probe, filtered from the level above it: the
+// taps are two source texels apart, so the kernel widens with every level and the
+// chain approximates an increasingly rough glossy lobe rather than a plain box downsample
+
+// interpolated values from the vertex shader
+in vec2 vCoord;
+
+// uniform input data
+uniform samplerCube uSource;
+uniform float uSourceLevel;
+uniform float uSourceTexel;		// size of a source texel in face coordinates
+uniform int uFace;				// GL cube map order: +x, -x, +y, -y, +z, -z
+
+// output data
+out vec4 fColor;
+
+// direction through a point of a face, the inverse of the GL cube map face selection;
+// points beyond the face edge continue onto its neighbours
+vec3 faceDirection(vec2 st)
+{
+	if (uFace == 0)
+		return vec3(1.0f, -st.y, -st.x);
+	if (uFace == 1)
+		return vec3(-1.0f, -st.y, st.x);
+	if (uFace == 2)
+		return vec3(st.x, 1.0f, st.y);
+	if (uFace == 3)
+		return vec3(st.x, -1.0f, -st.y);
+	if (uFace == 4)
+		return vec3(st.x, -st.y, 1.0f);
+	return vec3(-st.x, -st.y, -1.0f);
+}
+
+void main()
+{
+	// 3x3 binomial kernel, each tap itself a bilinear lookup
+	vec3 color = vec3(0.0f);
+	float total = 0.0f;
+	for (int y = -1; y <= 1; y++)
+	{
+		for (int x = -1; x <= 1; x++)
+		{
+			float weight = (2.0f - abs(float(x))) * (2.0f - abs(float(y)));
+			vec3 direction = faceDirection(vCoord + vec2(x, y) * 2.0f * uSourceTexel);
+			color += textureLod(uSource, direction, uSourceLevel).rgb * weight;
+			total += weight;
+		}
+	}
+
+	fColor = vec4(color / total, 1.0f);
+}
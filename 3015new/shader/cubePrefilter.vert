@@ -0,0 +1,13 @@
+#version 410 core
+
+// one triangle covering the viewport, generated from the vertex index without a vertex buffer
+
+// output data
+out vec2 vCoord;	// face coordinates, -1 to 1 across the viewport
+
+void main()
+{
+	vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	vCoord = corner * 2.0f - 1.0f;
+	gl_Position = vec4(vCoord, 0.0f, 1.0f);
+}
@@ -0,0 +1,388 @@
+#version 410 core
+
+// features, defined by the program variant:
+// TEXTURE				modulate with a colour map
+// NORMAL_MAP			perturb the normal with a tangent space normal map (BC5, xy only)
+// ENV_MAP				blend with a cube map reflection
+// DIRECTIONAL_LIGHT	light along uLight.dir, never attenuated
+// ATTENUATION			distance attenuation; without it only the constant term is applied
+// CLUSTERED			every light binned into the fragment's cluster instead of uLight alone
+// SHADOWS				shadow the directional light with the cascaded shadow maps
+// POINT_SHADOWS		shadow the point light with its cube shadow map
+// DEPTH_ONLY			no colour output, for shadow map passes
+// GBUFFER				write albedo, specular and normal to the G-buffer instead of lighting
+// DEFERRED				light the G-buffer texel under the fragment instead of interpolated values
+
+#ifdef CLUSTERED
+#extension GL_ARB_shader_storage_buffer_object : require
+#endif
+
+#ifdef DEPTH_ONLY
+// the depth test writes everything a shadow pass needs
+void main()
+{
+}
+#else
+
+#ifdef DEFERRED
+// rebuilt from the G-buffer depth, so the lighting functions read it as in the forward path
+vec3 vPosition;
+#else
+// interpolated values from the vertex shaders
+in vec3 vPosition;
+in vec3 vNormal;
+#ifdef NORMAL_MAP
+in vec3 vTangent;
+#endif
+#if defined(TEXTURE) || defined(NORMAL_MAP)
+in vec2 vTexCoord;
+#endif
+#endif
+
+// light properties
+struct Light
+{
+	vec3 pos;
+	float innerAngle;
+	vec3 dir;
+	float outerAngle;
+	vec3 La;
+	int type;
+	vec3 Ld;
+	float range;	// 0 when unbounded
+	vec3 Ls;
+	vec3 att;	// constant, linear, quadratic
+};
+
+// material properties
+struct Material
+{
+	vec3 Ka;
+	vec3 Kd;
+	vec3 Ks;
+	float shininess;
+};
+
+// per-frame uniform block (std140), shared by all programs
+layout(std140) uniform FrameBlock
+{
+	mat4 uViewMatrix;
+	mat4 uProjectionMatrix;
+	mat4 uViewProjectionMatrix;
+	vec3 uViewpoint;
+	Light uLight;
+};
+
+// per-material uniform block (std140)
+layout(std140) uniform MaterialBlock
+{
+	Material uMaterial;
+};
+
+#ifdef CLUSTERED
+// must match LightClusters::MAX_CLUSTER_LIGHTS
+const uint MAX_CLUSTER_LIGHTS = 128u;
+
+// cluster grid uniform block (std140)
+layout(std140) uniform ClusterBlock
+{
+	mat4 uInverseProjectionMatrix;
+	uvec4 uClusterGrid;		// clusters across, down and in depth, number of lights
+	vec4 uClusterTile;		// tile size in pixels, depth slice scale and bias
+	vec4 uClusterDepth;		// near and far plane
+};
+
+// lights and their clusters (std430), written by shader/lightCluster.comp
+layout(std430) readonly buffer LightBlock
+{
+	Light uLights[];
+};
+
+layout(std430) readonly buffer ClusterCountBlock
+{
+	uint uClusterCounts[];
+};
+
+layout(std430) readonly buffer ClusterIndexBlock
+{
+	uint uClusterLights[];
+};
+#endif
+
+// uniform input data
+#ifdef TEXTURE
+uniform sampler2D uTextureSampler;
+#endif
+#ifdef NORMAL_MAP
+uniform sampler2D uNormalSampler;
+#endif
+#ifdef ENV_MAP
+uniform samplerCube uEnvironmentMap;
+uniform float cubemapBlendFactor = 1.0;
+uniform float uEnvironmentLod = 0.0;	// mip level of the roughest reflection, prefiltered levels are blurrier
+#endif
+#ifdef DEFERRED
+// written by the GBUFFER variants
+uniform sampler2D uGBufferAlbedo;	// albedo, specular intensity
+uniform sampler2D uGBufferNormal;	// octahedral normal, shininess / 255, coverage
+uniform sampler2D uGBufferDepth;
+uniform mat4 uInverseViewProjectionMatrix;
+#endif
+
+#ifdef SHADOWS
+// must match MAX_SHADOW_CASCADES in ShadowCascades.h
+const int MAX_CASCADES = 4;
+
+// shadow uniform block (std140)
+layout(std140) uniform ShadowBlock
+{
+	mat4 uShadowMatrices[MAX_CASCADES];	// world to shadow map texture space
+	vec4 uCascadeSplits;				// far view distance of each cascade
+	ivec4 uShadowParams;				// cascade count, PCF kernel radius in texels
+	vec4 uShadowTexel;					// texel size, depth bias
+};
+
+uniform sampler2DArrayShadow uShadowMap;
+#endif
+
+#ifdef POINT_SHADOWS
+// point shadow uniform block (std140)
+layout(std140) uniform PointShadowBlock
+{
+	mat4 uFaceMatrices[6];		// world to clip space of each cube face
+	vec4 uPointShadowLight;		// light position, far plane
+	vec4 uPointShadowParams;	// near plane, depth bias in world units
+};
+
+uniform samplerCubeShadow uPointShadowMap;
+#endif
+
+// output data
+#ifdef GBUFFER
+layout(location = 0) out vec4 fAlbedo;
+layout(location = 1) out vec4 fNormal;
+#else
+out vec4 fColor;
+#endif
+
+// reflectance of the surface being lit, from the material block or the G-buffer
+vec3 surfaceKd;
+vec3 surfaceKs;
+float surfaceShininess;
+
+// diffuse and specular intensities of a light arriving along l
+vec3 shade(Light light, vec3 l, vec3 n, vec3 v, float attenuation)
+{
+	float dotLN = max(dot(l, n), 0.0f);
+	if (dotLN <= 0.0f)
+		return vec3(0.0f);
+
+	// halfway vector
+	vec3 h = normalize(l + v);
+
+	vec3 Id = light.Ld * surfaceKd * dotLN;
+	vec3 Is = light.Ls * surfaceKs * pow(max(dot(n, h), 0.0f), surfaceShininess);
+	return (Id + Is) * attenuation;
+}
+
+#if defined(GBUFFER) || defined(DEFERRED)
+// unit vector projected onto the octahedron and its lower half folded over the upper,
+// two components in [-1, 1] with about even precision in every direction
+vec2 octEncode(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	if (n.z < 0.0f)
+		n.xy = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+	return n.xy;
+}
+
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+	if (n.z < 0.0f)
+		n.xy = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+	return normalize(n);
+}
+#endif
+
+#ifdef SHADOWS
+// fraction of the directional light reaching this fragment, 1 beyond the last cascade
+float shadowVisibility()
+{
+	float depth = -(uViewMatrix * vec4(vPosition, 1.0f)).z;
+	int count = uShadowParams.x;
+	if (depth > uCascadeSplits[count - 1])
+		return 1.0f;
+
+	int cascade = 0;
+	while (cascade < count - 1 && depth > uCascadeSplits[cascade])
+		cascade++;
+
+	vec3 coord = (uShadowMatrices[cascade] * vec4(vPosition, 1.0f)).xyz;
+	float reference = coord.z - uShadowTexel.y;
+
+	// percentage closer filtering, each tap is itself a bilinear 2x2 comparison
+	int radius = uShadowParams.y;
+	float lit = 0.0f;
+	for (int y = -radius; y <= radius; y++)
+	{
+		for (int x = -radius; x <= radius; x++)
+			lit += texture(uShadowMap, vec4(coord.xy + vec2(x, y) * uShadowTexel.x, float(cascade), reference));
+	}
+	return lit / float((2 * radius + 1) * (2 * radius + 1));
+}
+#endif
+
+#ifdef POINT_SHADOWS
+// fraction of the point light reaching this fragment, 1 beyond the far plane
+float pointShadowVisibility()
+{
+	// the face's depth is the distance along its axis, the largest component
+	vec3 toFragment = vPosition - uPointShadowLight.xyz;
+	vec3 axes = abs(toFragment);
+	float distance = max(axes.x, max(axes.y, axes.z)) - uPointShadowParams.y;
+
+	float n = uPointShadowParams.x;
+	float f = uPointShadowLight.w;
+	if (distance >= f)
+		return 1.0f;
+
+	// the same perspective depth the faces were rendered with
+	float depth = ((f + n) / (f - n) - 2.0f * f * n / ((f - n) * max(distance, n))) * 0.5f + 0.5f;
+	return texture(uPointShadowMap, vec4(toFragment, depth));
+}
+#endif
+
+#ifdef CLUSTERED
+// index of the cluster holding this fragment
+uint findCluster()
+{
+	float depth = -(uViewMatrix * vec4(vPosition, 1.0f)).z;
+	float slice = clamp(log(max(depth, uClusterDepth.x)) * uClusterTile.z + uClusterTile.w, 0.0f, float(uClusterGrid.z - 1u));
+	uvec2 tile = min(uvec2(gl_FragCoord.xy / uClusterTile.xy), uClusterGrid.xy - 1u);
+	return tile.x + uClusterGrid.x * (tile.y + uClusterGrid.y * uint(slice));
+}
+#endif
+
+void main()
+{
+#ifdef DEFERRED
+	// everything the forward path interpolates comes from the G-buffer texel under the fragment
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	vec4 gAlbedo = texelFetch(uGBufferAlbedo, texel, 0);
+	vec4 gNormal = texelFetch(uGBufferNormal, texel, 0);
+	// nothing was drawn here, the clear colour stays
+	if (gNormal.a == 0.0f)
+		discard;
+
+	float depth = texelFetch(uGBufferDepth, texel, 0).r;
+	vec2 screen = gl_FragCoord.xy / vec2(textureSize(uGBufferDepth, 0));
+	vec4 position = uInverseViewProjectionMatrix * vec4(2.0f * vec3(screen, depth) - 1.0f, 1.0f);
+	vPosition = position.xyz / position.w;
+
+	vec3 n = octDecode(2.0f * gNormal.xy - 1.0f);
+	vec3 albedo = gAlbedo.rgb;
+
+	// like Ka below, Kd comes from the bound material rather than the G-buffer, so it scales
+	// the diffuse term alone as it does forward
+	surfaceKd = uMaterial.Kd;
+	surfaceKs = vec3(gAlbedo.a);
+	surfaceShininess = gNormal.b * 255.0f;
+#else
+	// fragment normal
+    vec3 n = normalize(vNormal);
+#ifdef NORMAL_MAP
+	// tangent, bitangent and normalMap
+	vec3 tangent = normalize(vTangent);
+    vec3 biTangent = normalize(cross(tangent, n));
+    // only x and y are stored (BC5), z is rebuilt from the unit length
+    vec2 normalXY = 2.0f * texture(uNormalSampler, vTexCoord).xy - 1.0f;
+    vec3 normalMap = vec3(normalXY, sqrt(max(1.0f - dot(normalXY, normalXY), 0.0f)));
+
+    n = normalize(mat3(tangent, biTangent, n) * normalMap);
+#endif
+
+	vec3 albedo = vec3(1.0f);
+#ifdef TEXTURE
+	albedo = texture(uTextureSampler, vTexCoord).rgb;
+#endif
+
+	surfaceKd = uMaterial.Kd;
+	surfaceKs = uMaterial.Ks;
+	surfaceShininess = uMaterial.shininess;
+#endif
+
+#ifdef GBUFFER
+	// specular is kept as a single intensity, so a tinted Ks loses its tint when lit deferred;
+	// Kd and Ka are not stored, the lighting pass reads them from the bound material
+	const vec3 LUMINANCE = vec3(0.2126f, 0.7152f, 0.0722f);
+	fAlbedo = vec4(albedo, dot(surfaceKs, LUMINANCE));
+	fNormal = vec4(0.5f * octEncode(n) + 0.5f, surfaceShininess / 255.0f, 1.0f);
+#else
+	// vector toward the viewer
+	vec3 v = normalize(uViewpoint - vPosition);
+
+	// ambient comes from the frame light alone, so it does not vary between clusters
+	vec3 Ia = uLight.La * uMaterial.Ka;
+	vec3 Ids = vec3(0.0f);
+
+#ifdef CLUSTERED
+	// only the lights that reach this cluster, however many the scene holds
+	uint cluster = findCluster();
+	uint count = min(uClusterCounts[cluster], MAX_CLUSTER_LIGHTS);
+	for (uint i = 0u; i < count; i++)
+	{
+		Light light = uLights[uClusterLights[cluster * MAX_CLUSTER_LIGHTS + i]];
+		if (light.type == 2)
+		{
+			Ids += shade(light, normalize(-light.dir), n, v, 1.0f);
+		}
+		else
+		{
+			vec3 toLight = light.pos - vPosition;
+			float dist = length(toLight);
+			float attenuation = 1.0f / (light.att.x + dist * light.att.y + dist * dist * light.att.z);
+			Ids += shade(light, toLight / dist, n, v, attenuation);
+		}
+	}
+#else
+	// vector towards the light
+#ifdef DIRECTIONAL_LIGHT
+    vec3 l = normalize(-uLight.dir);
+#else
+    vec3 l = normalize(uLight.pos - vPosition);
+#endif
+
+	// attenuation
+#if defined(DIRECTIONAL_LIGHT) && defined(SHADOWS)
+	float attenuation = shadowVisibility();
+#elif defined(DIRECTIONAL_LIGHT)
+	float attenuation = 1.0f;
+#elif defined(ATTENUATION)
+	float dist = length(uLight.pos - vPosition);
+	float attenuation = 1.0f / (uLight.att.x + dist * uLight.att.y + dist * dist * uLight.att.z);
+#else
+	float attenuation = 1.0f / uLight.att.x;
+#endif
+#if defined(POINT_SHADOWS) && !defined(DIRECTIONAL_LIGHT)
+	attenuation *= pointShadowVisibility();
+#endif
+
+	Ids = shade(uLight, l, n, v, attenuation);
+#endif
+
+	// intensity of reflected light, modulated with the colour map
+	vec3 color = (Ia + Ids) * albedo;
+
+#ifdef ENV_MAP
+	// modulate with environment map reflection
+	vec3 reflectEnvMap = reflect(-v, n);
+	// never sharper than the footprint would pick, so a mirror finish does not alias
+	float lod = max(textureQueryLod(uEnvironmentMap, reflectEnvMap).y, uEnvironmentLod);
+	color = mix(color, textureLod(uEnvironmentMap, reflectEnvMap, lod).rgb, cubemapBlendFactor);
+#endif
+
+	fColor = vec4(color, 1.0f);
+#endif
+}
+#endif
@@ -0,0 +1,136 @@
+#version 410 core
+
+// features, defined by the program variant:
+// TEXTURE				texture coordinates for a colour map
+// NORMAL_MAP			tangent and texture coordinates for a normal map
+// INSTANCED			model and normal matrices per instance instead of per draw
+// INDIRECT				model and normal matrices from a storage buffer, indexed by the base instance
+//						of a multi-draw indirect command; vertices are always in the tangent layout
+// DEPTH_ONLY			position only, for shadow map passes
+// LAYERED				world space position for shader/pointShadow.geom, which projects it per layer
+// DEFERRED				one triangle covering the viewport, for the deferred lighting pass
+
+#ifdef INDIRECT
+#extension GL_ARB_shader_draw_parameters : require
+#extension GL_ARB_shader_storage_buffer_object : require
+#endif
+
+#ifdef DEFERRED
+// generated from the vertex index without a vertex buffer, the G-buffer supplies everything else
+void main()
+{
+	vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	gl_Position = vec4(corner * 2.0f - 1.0f, 0.0f, 1.0f);
+}
+#else
+
+// input data
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec3 aNormal;
+#if defined(NORMAL_MAP) || defined(INDIRECT)
+layout(location = 2) in vec3 aTangent;
+layout(location = 3) in vec2 aTexCoord;
+#elif defined(TEXTURE)
+layout(location = 2) in vec2 aTexCoord;
+#endif
+
+#if defined(INDIRECT)
+// per-draw input data (std430)
+struct DrawData
+{
+	mat4 modelMatrix;
+	mat4 normalMatrix;	// mat3 padded to four columns
+};
+
+layout(std430) readonly buffer DrawBlock
+{
+	DrawData uDraws[];
+};
+#elif defined(INSTANCED)
+// per-instance input data
+layout(location = 4) in mat4 aModelMatrix;	// locations 4-7
+layout(location = 8) in mat3 aNormalMatrix;	// locations 8-10
+#else
+// uniform input data
+uniform mat4 uModelViewProjectionMatrix;
+uniform mat4 uModelMatrix;
+uniform mat3 uNormalMatrix;
+#endif
+
+// light properties
+struct Light
+{
+	vec3 pos;
+	float innerAngle;
+	vec3 dir;
+	float outerAngle;
+	vec3 La;
+	int type;
+	vec3 Ld;
+	float range;	// 0 when unbounded
+	vec3 Ls;
+	vec3 att;	// constant, linear, quadratic
+};
+
+// per-frame uniform block (std140), shared by all programs
+layout(std140) uniform FrameBlock
+{
+	mat4 uViewMatrix;
+	mat4 uProjectionMatrix;
+	mat4 uViewProjectionMatrix;
+	vec3 uViewpoint;
+	Light uLight;
+};
+
+// output data
+#if !defined(DEPTH_ONLY) || defined(LAYERED)
+out vec3 vPosition;
+#endif
+#ifndef DEPTH_ONLY
+out vec3 vNormal;
+#ifdef NORMAL_MAP
+out vec3 vTangent;
+#endif
+#if defined(TEXTURE) || defined(NORMAL_MAP)
+out vec2 vTexCoord;
+#endif
+#endif
+
+void main()
+{
+#if defined(INDIRECT)
+	// world space vertex position
+	vec4 position = uDraws[gl_BaseInstanceARB].modelMatrix * vec4(aPosition, 1.0f);
+	mat3 normalMatrix = mat3(uDraws[gl_BaseInstanceARB].normalMatrix);
+
+	gl_Position = uViewProjectionMatrix * position;
+#elif defined(INSTANCED)
+	// world space vertex position
+	vec4 position = aModelMatrix * vec4(aPosition, 1.0f);
+	mat3 normalMatrix = aNormalMatrix;
+
+	// set vertex position
+    gl_Position = uViewProjectionMatrix * position;
+#else
+	vec4 position = uModelMatrix * vec4(aPosition, 1.0f);
+	mat3 normalMatrix = uNormalMatrix;
+
+    gl_Position = uModelViewProjectionMatrix * vec4(aPosition, 1.0f);
+#endif
+
+#if !defined(DEPTH_ONLY) || defined(LAYERED)
+	vPosition = position.xyz;
+#endif
+#ifndef DEPTH_ONLY
+	// set vertex shader output
+	// will be interpolated for each fragment
+	vNormal = normalMatrix * aNormal;
+#ifdef NORMAL_MAP
+	vTangent = normalMatrix * aTangent;
+#endif
+#if defined(TEXTURE) || defined(NORMAL_MAP)
+	vTexCoord = aTexCoord;
+#endif
+#endif
+}
+#endif